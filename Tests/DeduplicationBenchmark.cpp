@@ -0,0 +1,222 @@
+// Times vertex deduplication in input vertices (OBJ corners) per second: the std::unordered_map<Vertex, uint32_t> loop
+// Model.cpp used before VertexHashTable, VertexDeduplication::deduplicate and deduplicateParallel
+// on 1 to N threads, and checks that all of them produce the same vertices and indices.
+// From this directory, in an optimized build:
+//   g++ -std=c++20 -O2 -pthread -I../VulkanFramework -I../Include -I../Include/IncludeVulkan -I../Include/glm
+//       DeduplicationBenchmark.cpp ../VulkanFramework/VertexDeduplication.cpp ../VulkanFramework/ObjLoader.cpp
+//       ../VulkanFramework/MappedFile.cpp ../VulkanFramework/ThreadPool.cpp -o DeduplicationBenchmark
+// or add the files to an empty console project in Release. Takes OBJ paths as arguments, by default the app's
+// vases when run from the project directory, and always adds a generated 10M triangle mesh (about 1.5 GB
+// of memory at peak). Returns nonzero on a mismatch.
+
+#include "VertexDeduplication.h"
+
+#include "Utils.h"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace std
+{
+	template<>
+	struct hash<Model::Vertex>
+	{
+		size_t operator()(Model::Vertex const& vertex) const
+		{
+			size_t seed = 0;
+			hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
+			return seed;
+		}
+	};
+}
+
+namespace
+{
+	constexpr int RUNS = 3;
+
+	// best of RUNS, in milliseconds
+	double time(const std::function<void()>& deduplicate)
+	{
+		double best = 1e30;
+		for (int run = 0; run < RUNS; run++)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			deduplicate();
+			const auto end = std::chrono::steady_clock::now();
+			best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+		}
+		return best;
+	}
+
+	// The loop Model::Builder::loadModel ran before VertexHashTable.
+	void deduplicateUnorderedMap(const ObjLoader::Mesh& mesh, std::vector<Model::Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		std::unordered_map<Model::Vertex, uint32_t> uniqueVertices{};
+		for (size_t i = 0; i < mesh.corners.size(); i++)
+		{
+			const Model::Vertex vertex = VertexDeduplication::vertexAt(mesh, i);
+			if (uniqueVertices.count(vertex) == 0)
+			{
+				uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
+				vertices.push_back(vertex);
+			}
+			indices.push_back(uniqueVertices[vertex]);
+		}
+	}
+
+	// A wavy grid of size x size quads, two triangles each, with a uv seam down the middle column
+	// so not every shared position is a shared vertex.
+	ObjLoader::Mesh generateMesh(int size)
+	{
+		ObjLoader::Mesh mesh;
+		const size_t side = static_cast<size_t>(size) + 1;
+		mesh.positions.reserve(side * side);
+		mesh.normals.reserve(side * side);
+		mesh.texcoords.reserve(side * side + side);
+		for (int y = 0; y <= size; y++)
+		{
+			for (int x = 0; x <= size; x++)
+			{
+				const float u = static_cast<float>(x) / size;
+				const float v = static_cast<float>(y) / size;
+				const float height = 0.05f * std::sin(u * 40.0f) * std::cos(v * 30.0f);
+				mesh.positions.push_back({ u * 10.0f - 5.0f, height, v * 10.0f - 5.0f });
+				mesh.normals.push_back(glm::normalize(glm::vec3{ -height, 1.0f, height * 0.5f }));
+				mesh.texcoords.push_back({ u, v });
+			}
+		}
+		mesh.colors.assign(mesh.positions.size(), glm::vec3{ 1.0f });
+		const int32_t seamTexcoords = static_cast<int32_t>(mesh.texcoords.size());
+		for (int y = 0; y <= size; y++)
+		{
+			mesh.texcoords.push_back({ 1.0f, static_cast<float>(y) / size });
+		}
+
+		mesh.corners.reserve(static_cast<size_t>(size) * size * 6);
+		const int seam = size / 2;
+		auto corner = [&](int x, int y, bool rightOfSeam)
+			{
+				const int32_t index = y * static_cast<int32_t>(side) + x;
+				const int32_t texcoord = x == seam && !rightOfSeam ? seamTexcoords + y : index;
+				mesh.corners.push_back({ index, index, texcoord });
+			};
+		for (int y = 0; y < size; y++)
+		{
+			for (int x = 0; x < size; x++)
+			{
+				const bool rightOfSeam = x >= seam;
+				corner(x, y, rightOfSeam);
+				corner(x + 1, y, rightOfSeam);
+				corner(x + 1, y + 1, rightOfSeam);
+				corner(x, y, rightOfSeam);
+				corner(x + 1, y + 1, rightOfSeam);
+				corner(x, y + 1, rightOfSeam);
+			}
+		}
+		return mesh;
+	}
+
+	bool benchmark(const std::string& name, const ObjLoader::Mesh& mesh, const std::vector<unsigned int>& threadCounts)
+	{
+		std::vector<Model::Vertex> referenceVertices;
+		std::vector<uint32_t> referenceIndices;
+		const double mapTime = time([&]()
+			{
+				std::vector<Model::Vertex>{}.swap(referenceVertices);
+				std::vector<uint32_t>{}.swap(referenceIndices);
+				deduplicateUnorderedMap(mesh, referenceVertices, referenceIndices);
+			});
+		const double corners = static_cast<double>(mesh.corners.size());
+		std::printf("%s: %zu triangles, %zu unique vertices\n  unordered_map     %9.2f ms, %7.2f M vertices/s\n", name.c_str(),
+			mesh.corners.size() / 3, referenceVertices.size(), mapTime, corners / mapTime / 1e3);
+
+		bool identical = true;
+		std::vector<Model::Vertex> vertices;
+		std::vector<uint32_t> indices;
+		auto report = [&](const char* label, double milliseconds)
+			{
+				const bool same = vertices == referenceVertices && indices == referenceIndices;
+				std::printf("  %-17s %9.2f ms, %7.2f M vertices/s, %.2fx%s\n", label, milliseconds, corners / milliseconds / 1e3,
+					mapTime / milliseconds, same ? "" : ", MISMATCH");
+				identical &= same;
+			};
+
+		const double serialTime = time([&]()
+			{
+				std::vector<Model::Vertex>{}.swap(vertices);
+				std::vector<uint32_t>{}.swap(indices);
+				VertexDeduplication::deduplicate(mesh, vertices, indices);
+			});
+		report("hash table serial", serialTime);
+
+		for (unsigned int threads : threadCounts)
+		{
+			ThreadPool threadPool{ threads };
+			const double parallelTime = time([&]()
+				{
+					std::vector<Model::Vertex>{}.swap(vertices);
+					std::vector<uint32_t>{}.swap(indices);
+					VertexDeduplication::deduplicateParallel(mesh, threadPool, vertices, indices);
+				});
+			char label[32];
+			std::snprintf(label, sizeof(label), "sharded %2u thr", threads);
+			report(label, parallelTime);
+		}
+		return identical;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; i++)
+	{
+		paths.push_back(argv[i]);
+	}
+	if (paths.empty())
+	{
+		for (const char* vase : { "models/smooth_vase.obj", "models/flat_vase.obj" })
+		{
+			if (std::filesystem::exists(vase))
+			{
+				paths.push_back(vase);
+			}
+		}
+	}
+
+	// at least up to 8, so small machines still check the merging of many shards and ranges
+	const unsigned int maxThreads = std::max(8u, std::thread::hardware_concurrency());
+	std::vector<unsigned int> threadCounts;
+	for (unsigned int threads = 1; threads < maxThreads; threads *= 2)
+	{
+		threadCounts.push_back(threads);
+	}
+	threadCounts.push_back(maxThreads);
+
+	bool identical = true;
+	for (const std::string& path : paths)
+	{
+		identical &= benchmark(path, ObjLoader{}.load(path), threadCounts);
+	}
+	// 2 * 2237^2 is just over 10M triangles
+	identical &= benchmark("generated grid", generateMesh(2237), threadCounts);
+
+	if (!identical)
+	{
+		std::printf("FAILED: deduplication paths differ\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,223 @@
+// Times EntityStore at 1M entities: creating them, destroy/create churn, updateTransforms with every
+// transform changed and with none, on 1 to N threads, and walking the dense component arrays against
+// looking every entity up by handle. Checks the handles after churn and the world matrices of every
+// update against their definition. From this directory, in an optimized build:
+//   g++ -std=c++20 -O2 -DNDEBUG -pthread -I../VulkanFramework -I../Include -I../Include/IncludeVulkan -I../Include/glm
+//       EntityStoreBenchmark.cpp ../VulkanFramework/EntityStore.cpp ../VulkanFramework/TransformComponent.cpp
+//       ../VulkanFramework/TransformKernel.cpp ../VulkanFramework/ThreadPool.cpp -o EntityStoreBenchmark
+// or add the files to an empty console project in Release. Returns nonzero on a mismatch.
+
+#include "EntityStore.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	constexpr uint32_t ENTITY_COUNT = 1000000;
+	// every group of this many is a root with the rest as its children, so there are two levels
+	constexpr uint32_t GROUP_SIZE = 4;
+	constexpr uint32_t CHURN_COUNT = 100000;
+	constexpr uint32_t MODEL_COUNT = 16;
+	constexpr int RUNS = 5;
+
+	uint32_t seed = 1;
+	float next(float low, float high)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return low + (high - low) * static_cast<float>(seed >> 8) / static_cast<float>(1u << 24);
+	}
+
+	// best of RUNS, in milliseconds, with prepare run untimed before every run
+	double time(const std::function<void()>& prepare, const std::function<void()>& measure)
+	{
+		double best = 1e30;
+		for (int run = 0; run < RUNS; run++)
+		{
+			prepare();
+			const auto start = std::chrono::steady_clock::now();
+			measure();
+			const auto end = std::chrono::steady_clock::now();
+			best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+		}
+		return best;
+	}
+
+	void populate(EntityStore& store, uint32_t count)
+	{
+		store.reserve(count);
+		Entity root;
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const Entity entity = store.create();
+			TransformComponent& transform = store.transform(entity);
+			transform.setTranslation({ next(-100.0f, 100.0f), next(-100.0f, 100.0f), next(-100.0f, 100.0f) });
+			transform.setRotation({ next(-3.0f, 3.0f), next(-3.0f, 3.0f), next(-3.0f, 3.0f) });
+			transform.setScale(glm::vec3{ next(0.5f, 2.0f) });
+			store.model(entity) = i % MODEL_COUNT;
+			if (i % GROUP_SIZE == 0)
+			{
+				root = entity;
+			}
+			else
+			{
+				store.setParent(entity, root);
+			}
+		}
+	}
+
+	void moveAll(EntityStore& store)
+	{
+		for (TransformComponent& transform : store.getTransforms())
+		{
+			transform.setRotation(transform.getRotation() + glm::vec3{ 0.01f });
+		}
+	}
+
+	// world matrices as the hierarchy defines them, from the cached local matrices
+	bool worldMatricesMatch(EntityStore& store)
+	{
+		const std::span<const Entity> entities = store.getEntities();
+		std::vector<uint32_t> denseIndices(Entity::INDEX_MASK + 1);
+		for (uint32_t i = 0; i < entities.size(); i++)
+		{
+			denseIndices[entities[i].index()] = i;
+		}
+
+		const std::span<const glm::mat4> worldMatrices = store.getWorldMatrices();
+		for (uint32_t i = 0; i < entities.size(); i++)
+		{
+			const glm::mat4& local = store.transform(entities[i]).mat4();
+			const Entity parent = store.getParent(entities[i]);
+			const glm::mat4 expected = parent == Entity{} ? local : worldMatrices[denseIndices[parent.index()]] * local;
+			if (worldMatrices[i] != expected)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+int main()
+{
+	bool correct = true;
+
+	EntityStore* created = nullptr;
+	const double createTime = time([&]() { delete created; created = new EntityStore{}; },
+		[&]() { populate(*created, ENTITY_COUNT); });
+	delete created;
+	std::printf("%u entities in groups of %u\n  create and parent  %8.2f ms, %6.1f ns per entity\n",
+		ENTITY_COUNT, GROUP_SIZE, createTime, createTime * 1e6 / ENTITY_COUNT);
+
+	EntityStore store;
+	populate(store, ENTITY_COUNT);
+	store.updateTransforms();
+
+	// destroys random live entities, orphaning their children, and creates a root for each
+	std::vector<Entity> destroyed;
+	const double churnTime = time([&]() { destroyed.clear(); }, [&]()
+		{
+			for (uint32_t i = 0; i < CHURN_COUNT; i++)
+			{
+				const std::span<const Entity> entities = store.getEntities();
+				const Entity victim = entities[static_cast<uint32_t>(next(0.0f, 1.0f) * entities.size()) % entities.size()];
+				store.destroy(victim);
+				destroyed.push_back(victim);
+				store.model(store.create()) = i % MODEL_COUNT;
+			}
+		});
+	std::printf("  destroy + create   %8.2f ms, %6.1f ns per pair\n", churnTime, churnTime * 1e6 / CHURN_COUNT);
+	if (store.size() != ENTITY_COUNT || std::any_of(destroyed.begin(), destroyed.end(), [&](Entity entity) { return store.isAlive(entity); }) ||
+		!std::all_of(store.getEntities().begin(), store.getEntities().end(), [&](Entity entity) { return store.isAlive(entity); }))
+	{
+		std::printf("  handles out of sync after churn\n");
+		correct = false;
+	}
+
+	// an update after any parenting change also rebuilds the hierarchy order
+	const Entity mover = store.create();
+	bool attached = false;
+	const double rebuildTime = time([&]()
+		{
+			attached = !attached;
+			store.setParent(mover, attached ? store.getEntities()[0] : Entity{});
+		},
+		[&]() { store.updateTransforms(); });
+	const double idleTime = time([]() {}, [&]() { store.updateTransforms(); });
+	std::printf("  update, reparented %8.2f ms\n  update, unchanged  %8.2f ms\n", rebuildTime, idleTime);
+
+	const double serialTime = time([&]() { moveAll(store); }, [&]() { store.updateTransforms(); });
+	std::printf("  update, all moved  %8.2f ms, %6.2f M matrices/s\n", serialTime, ENTITY_COUNT / serialTime / 1e3);
+	if (!worldMatricesMatch(store))
+	{
+		std::printf("  world matrices differ from parent * local\n");
+		correct = false;
+	}
+
+	// at least up to 8, so small machines still check the split of every level
+	const unsigned int maxThreads = std::max(8u, std::thread::hardware_concurrency());
+	std::vector<unsigned int> threadCounts;
+	for (unsigned int threads = 1; threads < maxThreads; threads *= 2)
+	{
+		threadCounts.push_back(threads);
+	}
+	threadCounts.push_back(maxThreads);
+
+	for (unsigned int threads : threadCounts)
+	{
+		ThreadPool threadPool{ threads };
+		const double parallelTime = time([&]() { moveAll(store); }, [&]() { store.updateTransforms(&threadPool); });
+		const bool same = worldMatricesMatch(store);
+		std::printf("  update, %2u thr     %8.2f ms, %6.2f M matrices/s, %.2fx%s\n", threads, parallelTime,
+			ENTITY_COUNT / parallelTime / 1e3, serialTime / parallelTime, same ? "" : ", MISMATCH");
+		correct &= same;
+	}
+
+	// what a render system does every frame, against the same through handles in slot order
+	std::vector<Entity> handles(store.getEntities().begin(), store.getEntities().end());
+	std::sort(handles.begin(), handles.end(), [](Entity a, Entity b) { return a.index() < b.index(); });
+	glm::vec3 denseSum{};
+	const double denseTime = time([&]() { denseSum = {}; }, [&]()
+		{
+			const std::span<const TransformComponent> transforms = store.getTransforms();
+			const std::span<const EntityStore::ModelHandle> models = store.getModels();
+			for (uint32_t i = 0; i < store.size(); i++)
+			{
+				if (models[i] != EntityStore::NO_MODEL)
+				{
+					denseSum += transforms[i].getTranslation();
+				}
+			}
+		});
+	glm::vec3 handleSum{};
+	const double handleTime = time([&]() { handleSum = {}; }, [&]()
+		{
+			for (Entity entity : handles)
+			{
+				if (store.model(entity) != EntityStore::NO_MODEL)
+				{
+					handleSum += store.transform(entity).getTranslation();
+				}
+			}
+		});
+	std::printf("  dense iteration    %8.2f ms, %6.2f ns per entity\n  handle lookups     %8.2f ms, %6.2f ns per entity\n",
+		denseTime, denseTime * 1e6 / ENTITY_COUNT, handleTime, handleTime * 1e6 / ENTITY_COUNT);
+	// the sums keep the loops from being optimized away, and only differ by rounding
+	if (glm::length(denseSum - handleSum) > 1e-3f * glm::length(denseSum))
+	{
+		std::printf("  dense arrays and handles disagree\n");
+		correct = false;
+	}
+
+	if (!correct)
+	{
+		std::printf("FAILED: EntityStore is inconsistent\n");
+		return 1;
+	}
+	return 0;
+}
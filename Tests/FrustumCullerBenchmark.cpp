@@ -0,0 +1,94 @@
+// Culls 100k random objects with FrustumCuller, checks the result against a plain per-object
+// plane test and reports the time per cull. From this directory, in an optimized build:
+//   g++ -std=c++20 -O2 -I../VulkanFramework -I../Include/glm FrustumCullerBenchmark.cpp
+//       ../VulkanFramework/FrustumCuller.cpp -o FrustumCullerBenchmark
+// or add both files to an empty console project in Release. Returns nonzero on a mismatch.
+
+#include "FrustumCuller.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+	constexpr uint32_t OBJECT_COUNT = 100000;
+	constexpr int RUNS = 200;
+
+	bool isOutside(const BoundingSphere& sphere, const BoundingBox& box, const Frustum& frustum)
+	{
+		for (const glm::vec4& plane : frustum.planes)
+		{
+			const glm::vec3 normal{ plane };
+			if (glm::dot(normal, sphere.center) + plane.w < -sphere.radius)
+			{
+				return true;
+			}
+			if (glm::dot(normal, box.center()) + plane.w < -glm::dot(glm::abs(normal), box.extent()))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+}
+
+int main()
+{
+	uint32_t seed = 1;
+	auto next = [&seed](float low, float high)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return low + (high - low) * static_cast<float>(seed >> 8) / static_cast<float>(1u << 24);
+	};
+
+	// spread around the camera, which sees about an eighth of them
+	std::vector<BoundingSphere> spheres;
+	std::vector<BoundingBox> boxes;
+	FrustumCuller culler;
+	culler.reserve(OBJECT_COUNT);
+	for (uint32_t i = 0; i < OBJECT_COUNT; i++)
+	{
+		const glm::vec3 center{ next(-200.0f, 200.0f), next(-50.0f, 50.0f), next(-200.0f, 200.0f) };
+		const glm::vec3 extent{ next(0.1f, 3.0f), next(0.1f, 3.0f), next(0.1f, 3.0f) };
+		spheres.push_back({ center, glm::length(extent) });
+		boxes.push_back({ center - extent, center + extent });
+		culler.add(spheres.back(), boxes.back());
+	}
+
+	const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 150.0f);
+	const glm::mat4 view = glm::lookAt(glm::vec3{ 0.0f, 5.0f, 0.0f }, glm::vec3{ 1.0f, 5.0f, 1.0f }, glm::vec3{ 0.0f, 1.0f, 0.0f });
+	const Frustum frustum = Frustum::fromMatrix(projection * view);
+
+	std::vector<uint32_t> expected;
+	for (uint32_t i = 0; i < OBJECT_COUNT; i++)
+	{
+		if (!isOutside(spheres[i], boxes[i], frustum))
+		{
+			expected.push_back(i);
+		}
+	}
+
+	std::vector<uint32_t> visible;
+	std::vector<double> times;
+	for (int run = 0; run < RUNS; run++)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		culler.cull(frustum, visible);
+		const auto end = std::chrono::steady_clock::now();
+		times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+	}
+	std::sort(times.begin(), times.end());
+
+	std::printf("%u objects, %zu visible, median %.3f ms, best %.3f ms per cull\n",
+		OBJECT_COUNT, visible.size(), times[times.size() / 2], times.front());
+	if (visible != expected)
+	{
+		std::printf("FAILED: %zu visible, the per-object test finds %zu\n", visible.size(), expected.size());
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,126 @@
+// Standalone check for 16/32-bit index selection and their placement in a shared index buffer.
+// Needs no device; from this directory:
+//   g++ -std=c++20 -I../VulkanFramework -I../Include -I../Include/IncludeVulkan -I../Include/GLFW -I../Include/glm
+//       -I../Libraries/tinyobjloader IndexTypeCheck.cpp ../VulkanFramework/RangeAllocator.cpp -o IndexTypeCheck
+// or add both files to an empty console project. Returns nonzero on failure.
+
+#include "Model.h"
+
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+	int failures = 0;
+
+	void check(bool condition, const char* what)
+	{
+		if (!condition)
+		{
+			std::printf("FAILED: %s\n", what);
+			failures++;
+		}
+	}
+
+	struct Placed
+	{
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		VkIndexType indexType;
+
+		uint64_t begin() const
+		{
+			return firstIndex * GeometryPool::indexSize(indexType);
+		}
+		uint64_t end() const
+		{
+			return begin() + indexCount * GeometryPool::indexSize(indexType);
+		}
+	};
+
+	bool place(RangeAllocator& indexRanges, std::vector<Placed>& placed, uint32_t indexCount, VkIndexType indexType)
+	{
+		Placed range{ 0, indexCount, indexType };
+		if (!GeometryPool::allocateIndices(indexRanges, indexCount, indexType, range.firstIndex))
+		{
+			return false;
+		}
+		placed.push_back(range);
+		return true;
+	}
+
+	bool disjoint(const std::vector<Placed>& placed)
+	{
+		for (size_t i = 0; i < placed.size(); i++)
+		{
+			for (size_t j = i + 1; j < placed.size(); j++)
+			{
+				if (placed[i].begin() < placed[j].end() && placed[j].begin() < placed[i].end())
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+}
+
+int main()
+{
+	// vertex count, so the largest index is one less
+	check(Model::indexTypeFor(1) == VK_INDEX_TYPE_UINT16, "indexTypeFor(1) is UINT16");
+	check(Model::indexTypeFor(65535) == VK_INDEX_TYPE_UINT16, "indexTypeFor(65535) is UINT16");
+	check(Model::indexTypeFor(65536) == VK_INDEX_TYPE_UINT16, "indexTypeFor(65536) is UINT16");
+	check(Model::indexTypeFor(65537) == VK_INDEX_TYPE_UINT32, "indexTypeFor(65537) is UINT32");
+
+	{
+		// an odd number of 16-bit indices leaves the next 32-bit range misaligned unless it is padded
+		RangeAllocator indexRanges(64);
+		std::vector<Placed> placed;
+		check(place(indexRanges, placed, 3, VK_INDEX_TYPE_UINT16), "3 x UINT16 fits");
+		check(place(indexRanges, placed, 2, VK_INDEX_TYPE_UINT32), "2 x UINT32 fits");
+		check(placed[0].firstIndex == 0, "first UINT16 range starts at 0");
+		check(placed[1].begin() == 8 && placed[1].firstIndex == 2, "UINT32 range is padded to byte 8, index 2");
+		// the padding is still usable by a 16-bit range
+		check(place(indexRanges, placed, 1, VK_INDEX_TYPE_UINT16), "1 x UINT16 fits");
+		check(placed[2].begin() == 6 && placed[2].firstIndex == 3, "UINT16 range fills the padding at index 3");
+		check(disjoint(placed), "ranges do not overlap");
+	}
+
+	{
+		// mixed churn: every range stays aligned to its own index size and within the buffer
+		RangeAllocator indexRanges(1 << 16);
+		std::vector<Placed> placed;
+		uint32_t seed = 1;
+		for (int i = 0; i < 2000; i++)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			if (!placed.empty() && (seed >> 28) < 6)
+			{
+				const size_t victim = (seed >> 8) % placed.size();
+				GeometryPool::freeIndices(indexRanges, placed[victim].firstIndex, placed[victim].indexCount, placed[victim].indexType);
+				placed.erase(placed.begin() + victim);
+				continue;
+			}
+			const VkIndexType indexType = (seed >> 27) & 1 ? VK_INDEX_TYPE_UINT32 : VK_INDEX_TYPE_UINT16;
+			place(indexRanges, placed, 1 + (seed >> 16) % 257, indexType);
+		}
+		bool aligned = true;
+		bool inBounds = true;
+		for (const Placed& range : placed)
+		{
+			aligned &= range.begin() % GeometryPool::indexSize(range.indexType) == 0;
+			inBounds &= range.end() <= indexRanges.getSize();
+		}
+		check(!placed.empty(), "churn leaves live ranges");
+		check(aligned, "churned ranges are aligned to their index size");
+		check(inBounds, "churned ranges stay in the buffer");
+		check(disjoint(placed), "churned ranges do not overlap");
+	}
+
+	if (failures == 0)
+	{
+		std::printf("IndexTypeCheck passed\n");
+	}
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,197 @@
+// Times ObjLoader against tinyobj::LoadObj on 1 to N threads and checks that both produce the same
+// attributes and triangles, bit for bit. From this directory, in an optimized build:
+//   g++ -std=c++20 -O2 -pthread -I../VulkanFramework -I../Include/glm -I../Libraries/tinyobjloader ObjLoaderBenchmark.cpp
+//       ../VulkanFramework/ObjLoader.cpp ../VulkanFramework/MappedFile.cpp ../VulkanFramework/ThreadPool.cpp -o ObjLoaderBenchmark
+// or add the files to an empty console project in Release. Takes OBJ paths as arguments, by default the app's
+// vases when run from the project directory, and always adds a generated mesh. Returns nonzero on a mismatch.
+
+#include "ObjLoader.h"
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	constexpr int RUNS = 5;
+
+	// best of RUNS, in milliseconds
+	double time(const std::function<void()>& load)
+	{
+		double best = 1e30;
+		for (int run = 0; run < RUNS; run++)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			load();
+			const auto end = std::chrono::steady_clock::now();
+			best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+		}
+		return best;
+	}
+
+	template<typename T>
+	bool sameFloats(const std::vector<T>& loaded, const std::vector<tinyobj::real_t>& reference)
+	{
+		return loaded.size() * sizeof(T) == reference.size() * sizeof(tinyobj::real_t) &&
+			(loaded.empty() || memcmp(loaded.data(), reference.data(), reference.size() * sizeof(tinyobj::real_t)) == 0);
+	}
+
+	bool sameMesh(const ObjLoader::Mesh& mesh, const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes)
+	{
+		if (!sameFloats(mesh.positions, attrib.vertices) || !sameFloats(mesh.colors, attrib.colors) ||
+			!sameFloats(mesh.normals, attrib.normals) || !sameFloats(mesh.texcoords, attrib.texcoords))
+		{
+			return false;
+		}
+		size_t corner = 0;
+		for (const tinyobj::shape_t& shape : shapes)
+		{
+			for (const tinyobj::index_t& index : shape.mesh.indices)
+			{
+				if (corner >= mesh.corners.size() || mesh.corners[corner].position != index.vertex_index ||
+					mesh.corners[corner].normal != index.normal_index || mesh.corners[corner].texcoord != index.texcoord_index)
+				{
+					return false;
+				}
+				corner++;
+			}
+		}
+		return corner == mesh.corners.size();
+	}
+
+	// A wavy grid of quads with normals and uvs, about 25 MB, printed with varying precision like exporters do.
+	std::string writeGeneratedObj()
+	{
+		const std::string path = (std::filesystem::temp_directory_path() / "ObjLoaderBenchmark.obj").string();
+		std::ofstream out{ path };
+		constexpr int size = 400;
+		char line[128];
+		for (int y = 0; y <= size; y++)
+		{
+			for (int x = 0; x <= size; x++)
+			{
+				const float u = static_cast<float>(x) / size;
+				const float v = static_cast<float>(y) / size;
+				const float height = 0.05f * std::sin(u * 40.0f) * std::cos(v * 30.0f);
+				snprintf(line, sizeof(line), "v %.6f %.4f %.7g\nvn %.5f %.5f %.5f\nvt %.6f %.6f\n",
+					u * 10.0f - 5.0f, height, v * 10.0f - 5.0f, -height, 1.0f, height * 0.5f, u, v);
+				out << line;
+			}
+		}
+		out << "g grid\n";
+		for (int y = 0; y < size; y++)
+		{
+			for (int x = 0; x < size; x++)
+			{
+				const int a = y * (size + 1) + x + 1;
+				const int b = a + size + 1;
+				if ((x + y) % 7 == 0)
+				{
+					// some triangles among the quads, the second one with a relative first corner for a + 1
+					snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d\nf -%d/-%d/-%d %d/%d/%d %d/%d/%d\n",
+						a, a, a, a + 1, a + 1, a + 1, b, b, b,
+						static_cast<int>((size + 1) * (size + 1)) - a, static_cast<int>((size + 1) * (size + 1)) - a,
+						static_cast<int>((size + 1) * (size + 1)) - a, b + 1, b + 1, b + 1, b, b, b);
+				}
+				else
+				{
+					snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n",
+						a, a, a, a + 1, a + 1, a + 1, b + 1, b + 1, b + 1, b, b, b);
+				}
+				out << line;
+			}
+		}
+		return path;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; i++)
+	{
+		paths.push_back(argv[i]);
+	}
+	if (paths.empty())
+	{
+		for (const char* vase : { "models/smooth_vase.obj", "models/flat_vase.obj" })
+		{
+			if (std::filesystem::exists(vase))
+			{
+				paths.push_back(vase);
+			}
+		}
+	}
+	paths.push_back(writeGeneratedObj());
+
+	// at least up to 8, so small machines still check the stitching of many chunks
+	const unsigned int maxThreads = std::max(8u, std::thread::hardware_concurrency());
+	std::vector<unsigned int> threadCounts;
+	for (unsigned int threads = 1; threads < maxThreads; threads *= 2)
+	{
+		threadCounts.push_back(threads);
+	}
+	threadCounts.push_back(maxThreads);
+
+	bool identical = true;
+	for (const std::string& path : paths)
+	{
+		tinyobj::attrib_t attrib;
+		std::vector<tinyobj::shape_t> shapes;
+		std::vector<tinyobj::material_t> materials;
+		std::string warn;
+		std::string err;
+		const double tinyobjTime = time([&]()
+			{
+				attrib = {};
+				shapes.clear();
+				materials.clear();
+				if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str()))
+				{
+					throw std::runtime_error(warn + err);
+				}
+			});
+		size_t corners = 0;
+		for (const tinyobj::shape_t& shape : shapes)
+		{
+			corners += shape.mesh.indices.size();
+		}
+		std::printf("%s: %.1f MB, %zu triangles\n  tinyobj           %8.2f ms\n", path.c_str(),
+			static_cast<double>(std::filesystem::file_size(path)) / (1 << 20), corners / 3, tinyobjTime);
+
+		ObjLoader::Mesh mesh;
+		const double serialTime = time([&]() { mesh = ObjLoader{}.load(path); });
+		const bool serialIdentical = sameMesh(mesh, attrib, shapes);
+		std::printf("  ObjLoader serial  %8.2f ms, %.2fx%s\n", serialTime, tinyobjTime / serialTime, serialIdentical ? "" : ", MISMATCH");
+		identical &= serialIdentical;
+
+		for (unsigned int threads : threadCounts)
+		{
+			ThreadPool threadPool{ threads };
+			const double parallelTime = time([&]() { mesh = ObjLoader{ &threadPool }.load(path); });
+			const bool parallelIdentical = sameMesh(mesh, attrib, shapes);
+			std::printf("  ObjLoader %2u thr  %8.2f ms, %.2fx%s\n", threads, parallelTime, tinyobjTime / parallelTime,
+				parallelIdentical ? "" : ", MISMATCH");
+			identical &= parallelIdentical;
+		}
+	}
+
+	if (!identical)
+	{
+		std::printf("FAILED: ObjLoader differs from tinyobj\n");
+		return 1;
+	}
+	return 0;
+}
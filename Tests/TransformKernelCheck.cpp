@@ -0,0 +1,106 @@
+// Standalone check of the SSE transform kernel against its scalar reference, and the matrices per
+// second of both. From this directory, in an optimized build:
+//   g++ -std=c++20 -O2 -I../VulkanFramework -I../Include/glm TransformKernelCheck.cpp
+//       ../VulkanFramework/TransformKernel.cpp -o TransformKernelCheck
+// or add both files to an empty console project in Release. Returns nonzero on failure.
+
+#include "TransformKernel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+	// sin and cos are range reduced in single precision, so allow a few ulps past |angle| of 1e4
+	constexpr float TOLERANCE = 2e-6f;
+	constexpr float MAX_ANGLE = 1e4f;
+	constexpr int RUNS = 20;
+
+	float maxError = 0.0f;
+
+	// relative to the larger of the element and 1, as rotation terms are bounded by the scale
+	void compare(float value, float reference)
+	{
+		const float error = std::abs(value - reference) / std::max(1.0f, std::abs(reference));
+		maxError = std::isnan(error) ? INFINITY : std::max(maxError, error);
+	}
+
+	// best of RUNS, in matrices per second
+	template<typename Compute>
+	double throughput(size_t count, Compute&& compute)
+	{
+		double best = 1e30;
+		for (int run = 0; run < RUNS; run++)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			compute();
+			const auto end = std::chrono::steady_clock::now();
+			best = std::min(best, std::chrono::duration<double>(end - start).count());
+		}
+		return count / best;
+	}
+}
+
+int main()
+{
+	TransformKernel::Batch batch;
+	uint32_t seed = 1;
+	auto next = [&seed](float low, float high)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return low + (high - low) * static_cast<float>(seed >> 8) / static_cast<float>(1u << 24);
+	};
+	// odd count so the tail after the last group of four is covered
+	for (int i = 0; i < 100003; i++)
+	{
+		// sweep the angle magnitude evenly in decades so small angles are not drowned out
+		const float magnitude = std::pow(10.0f, next(-3.0f, std::log10(MAX_ANGLE)));
+		batch.push(
+			{ next(-100.0f, 100.0f), next(-100.0f, 100.0f), next(-100.0f, 100.0f) },
+			{ magnitude * next(-1.0f, 1.0f), magnitude * next(-1.0f, 1.0f), magnitude * next(-1.0f, 1.0f) },
+			{ next(0.25f, 4.0f), next(0.25f, 4.0f), next(0.25f, 4.0f) });
+	}
+	batch.push({}, { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f });
+	batch.push({}, { MAX_ANGLE, -MAX_ANGLE, MAX_ANGLE }, { 1.0f, 1.0f, 1.0f });
+
+	const size_t count = batch.size();
+	std::vector<glm::mat4> matrices(count), referenceMatrices(count);
+	std::vector<glm::mat3> normalMatrices(count), referenceNormalMatrices(count);
+	TransformKernel::compute(batch, matrices.data(), normalMatrices.data());
+	TransformKernel::computeReference(batch, referenceMatrices.data(), referenceNormalMatrices.data());
+
+	for (size_t i = 0; i < count; i++)
+	{
+		for (int column = 0; column < 4; column++)
+		{
+			for (int row = 0; row < 4; row++)
+			{
+				compare(matrices[i][column][row], referenceMatrices[i][column][row]);
+			}
+		}
+		for (int column = 0; column < 3; column++)
+		{
+			for (int row = 0; row < 3; row++)
+			{
+				compare(normalMatrices[i][column][row], referenceNormalMatrices[i][column][row]);
+			}
+		}
+	}
+
+	const double kernelRate = throughput(count, [&]() { TransformKernel::compute(batch, matrices.data(), normalMatrices.data()); });
+	const double referenceRate = throughput(count,
+		[&]() { TransformKernel::computeReference(batch, referenceMatrices.data(), referenceNormalMatrices.data()); });
+
+	std::printf("%zu transforms, max error %g (tolerance %g)\n", count, maxError, TOLERANCE);
+	std::printf("compute %.1f M matrices/s, computeReference %.1f M matrices/s, %.2fx\n",
+		kernelRate / 1e6, referenceRate / 1e6, kernelRate / referenceRate);
+	if (maxError > TOLERANCE)
+	{
+		std::printf("FAILED: compute drifts from computeReference\n");
+		return 1;
+	}
+	return 0;
+}
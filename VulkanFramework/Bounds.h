@@ -0,0 +1,48 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+struct BoundingBox
+{
+	glm::vec3 min{};
+	glm::vec3 max{};
+
+	glm::vec3 center() const
+	{
+		return (min + max) * 0.5f;
+	}
+	glm::vec3 extent() const
+	{
+		return (max - min) * 0.5f;
+	}
+	// Box around this box under an affine transform (Arvo 1990), without transforming all eight corners.
+	BoundingBox transformed(const glm::mat4& m) const
+	{
+		const glm::vec3 c = glm::vec3(m * glm::vec4(center(), 1.0f));
+		const glm::vec3 e = extent();
+		const glm::vec3 newExtent =
+			glm::abs(glm::vec3(m[0])) * e.x +
+			glm::abs(glm::vec3(m[1])) * e.y +
+			glm::abs(glm::vec3(m[2])) * e.z;
+		return { c - newExtent, c + newExtent };
+	}
+};
+
+struct BoundingSphere
+{
+	glm::vec3 center{};
+	float radius = 0.0f;
+
+	// Sphere around this sphere under an affine transform; the radius grows by the largest axis scale.
+	BoundingSphere transformed(const glm::mat4& m) const
+	{
+		const float scale2 = std::max(glm::dot(glm::vec3(m[0]), glm::vec3(m[0])),
+			std::max(glm::dot(glm::vec3(m[1]), glm::vec3(m[1])), glm::dot(glm::vec3(m[2]), glm::vec3(m[2]))));
+		return { glm::vec3(m * glm::vec4(center, 1.0f)), radius * std::sqrt(scale2) };
+	}
+};
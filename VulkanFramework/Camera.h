@@ -4,6 +4,8 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 
+#include "Frustum.h"
+
 class Camera
 {
 public:
@@ -22,6 +24,11 @@ public:
 	{
 		return viewMatrix;
 	}
+	// world space planes of the view volume
+	Frustum getFrustum() const
+	{
+		return Frustum::fromMatrix(projectionMatrix * viewMatrix);
+	}
 private:
 	glm::mat4 projectionMatrix { 1.0f };
 	glm::mat4 viewMatrix{ 1.0f };
@@ -0,0 +1,160 @@
+#include "CommandRecorder.h"
+
+#include <cassert>
+#include <cstring>
+
+CommandRecorder::CommandRecorder(VkCommandBuffer commandBuffer)
+	:
+	commandBuffer(commandBuffer)
+{}
+
+void CommandRecorder::bindPipeline(VkPipelineBindPoint bindPoint, VkPipeline pipeline)
+{
+	BindPointState& state = bindPoints[bindPointIndex(bindPoint)];
+	if (state.pipeline == pipeline)
+	{
+		stats.pipelines.skipped++;
+		return;
+	}
+	if (commandBuffer != VK_NULL_HANDLE)
+	{
+		vkCmdBindPipeline(commandBuffer, bindPoint, pipeline);
+	}
+	state.pipeline = pipeline;
+	stats.pipelines.emitted++;
+}
+
+void CommandRecorder::bindVertexBuffers(uint32_t firstBinding, uint32_t bindingCount, const VkBuffer* buffers,
+	const VkDeviceSize* offsets)
+{
+	assert(firstBinding + bindingCount <= MAX_VERTEX_BINDINGS && "Too many vertex bindings!");
+
+	bool bound = true;
+	for (uint32_t i = 0; i < bindingCount; i++)
+	{
+		bound = bound && vertexBuffers[firstBinding + i] == buffers[i] && vertexOffsets[firstBinding + i] == offsets[i];
+	}
+	if (bound)
+	{
+		stats.vertexBuffers.skipped++;
+		return;
+	}
+	if (commandBuffer != VK_NULL_HANDLE)
+	{
+		vkCmdBindVertexBuffers(commandBuffer, firstBinding, bindingCount, buffers, offsets);
+	}
+	for (uint32_t i = 0; i < bindingCount; i++)
+	{
+		vertexBuffers[firstBinding + i] = buffers[i];
+		vertexOffsets[firstBinding + i] = offsets[i];
+	}
+	stats.vertexBuffers.emitted++;
+}
+
+void CommandRecorder::bindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType type)
+{
+	if (indexBuffer == buffer && indexOffset == offset && indexType == type)
+	{
+		stats.indexBuffers.skipped++;
+		return;
+	}
+	if (commandBuffer != VK_NULL_HANDLE)
+	{
+		vkCmdBindIndexBuffer(commandBuffer, buffer, offset, type);
+	}
+	indexBuffer = buffer;
+	indexOffset = offset;
+	indexType = type;
+	stats.indexBuffers.emitted++;
+}
+
+void CommandRecorder::bindDescriptorSets(VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t firstSet, uint32_t setCount,
+	const VkDescriptorSet* sets, uint32_t dynamicOffsetCount, const uint32_t* dynamicOffsets)
+{
+	assert(firstSet + setCount <= MAX_DESCRIPTOR_SETS && "Too many descriptor sets!");
+
+	BindPointState& state = bindPoints[bindPointIndex(bindPoint)];
+	bool bound = state.setLayout == layout && dynamicOffsetCount == 0;
+	for (uint32_t i = 0; i < setCount; i++)
+	{
+		bound = bound && state.sets[firstSet + i] == sets[i];
+	}
+	if (bound)
+	{
+		stats.descriptorSets.skipped++;
+		return;
+	}
+	if (commandBuffer != VK_NULL_HANDLE)
+	{
+		vkCmdBindDescriptorSets(commandBuffer, bindPoint, layout, firstSet, setCount, sets, dynamicOffsetCount, dynamicOffsets);
+	}
+	// a different layout may disturb the sets it doesn't rebind, so they are forgotten
+	if (state.setLayout != layout)
+	{
+		state.sets.fill(VK_NULL_HANDLE);
+		state.setLayout = layout;
+	}
+	for (uint32_t i = 0; i < setCount; i++)
+	{
+		state.sets[firstSet + i] = dynamicOffsetCount == 0 ? sets[i] : VK_NULL_HANDLE;
+	}
+	stats.descriptorSets.emitted++;
+}
+
+void CommandRecorder::pushConstants(VkPipelineLayout layout, VkShaderStageFlags stages, uint32_t offset, uint32_t size,
+	const void* values)
+{
+	if (layout != pushLayout || stages != pushStages)
+	{
+		pushLayout = layout;
+		pushStages = stages;
+		pushWritten.reset();
+	}
+	if (offset + size > MAX_PUSH_CONSTANT_SIZE)
+	{
+		if (commandBuffer != VK_NULL_HANDLE)
+		{
+			vkCmdPushConstants(commandBuffer, layout, stages, offset, size, values);
+		}
+		pushWritten.reset();
+		stats.pushConstants.emitted++;
+		return;
+	}
+
+	bool written = true;
+	for (uint32_t i = offset; i < offset + size; i++)
+	{
+		written = written && pushWritten[i];
+	}
+	if (written && memcmp(pushData.data() + offset, values, size) == 0)
+	{
+		stats.pushConstants.skipped++;
+		return;
+	}
+	if (commandBuffer != VK_NULL_HANDLE)
+	{
+		vkCmdPushConstants(commandBuffer, layout, stages, offset, size, values);
+	}
+	memcpy(pushData.data() + offset, values, size);
+	for (uint32_t i = offset; i < offset + size; i++)
+	{
+		pushWritten[i] = true;
+	}
+	stats.pushConstants.emitted++;
+}
+
+void CommandRecorder::invalidate()
+{
+	bindPoints = {};
+	vertexBuffers.fill(VK_NULL_HANDLE);
+	indexBuffer = VK_NULL_HANDLE;
+	indexType = VK_INDEX_TYPE_MAX_ENUM;
+	pushLayout = VK_NULL_HANDLE;
+	pushWritten.reset();
+}
+
+uint32_t CommandRecorder::bindPointIndex(VkPipelineBindPoint bindPoint)
+{
+	assert((bindPoint == VK_PIPELINE_BIND_POINT_GRAPHICS || bindPoint == VK_PIPELINE_BIND_POINT_COMPUTE) && "Unsupported bind point!");
+	return bindPoint == VK_PIPELINE_BIND_POINT_COMPUTE ? 1 : 0;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <array>
+#include <bitset>
+#include <cstdint>
+
+// Records state commands into a command buffer, skipping the ones that would rebind what is already bound:
+// pipelines per bind point, vertex buffers and their offsets, the index buffer, descriptor sets with their
+// layout, and push constant bytes. It only knows what went through it, so a recorder is made per recording
+// and invalidate() follows any state command recorded around it. Made with VK_NULL_HANDLE it records nothing
+// and only counts, to compare orders of the same commands.
+class CommandRecorder
+{
+public:
+	struct Counts
+	{
+		uint32_t emitted = 0;
+		uint32_t skipped = 0;
+	};
+	struct Stats
+	{
+		Counts pipelines;
+		Counts vertexBuffers;
+		Counts indexBuffers;
+		Counts descriptorSets;
+		Counts pushConstants;
+	};
+	static constexpr uint32_t MAX_VERTEX_BINDINGS = 8;
+	static constexpr uint32_t MAX_DESCRIPTOR_SETS = 4;
+	// the size every device supports, larger pushes are never skipped
+	static constexpr uint32_t MAX_PUSH_CONSTANT_SIZE = 128;
+public:
+	explicit CommandRecorder(VkCommandBuffer commandBuffer);
+	CommandRecorder(const CommandRecorder&) = delete;
+	CommandRecorder& operator=(const CommandRecorder&) = delete;
+
+	// for the commands that are never redundant, like draws and barriers
+	VkCommandBuffer getCommandBuffer() const
+	{
+		return commandBuffer;
+	}
+
+	void bindPipeline(VkPipelineBindPoint bindPoint, VkPipeline pipeline);
+	void bindVertexBuffers(uint32_t firstBinding, uint32_t bindingCount, const VkBuffer* buffers, const VkDeviceSize* offsets);
+	void bindIndexBuffer(VkBuffer buffer, VkDeviceSize offset, VkIndexType indexType);
+	// sets bound with dynamic offsets are always rebound
+	void bindDescriptorSets(VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t firstSet, uint32_t setCount,
+		const VkDescriptorSet* sets, uint32_t dynamicOffsetCount = 0, const uint32_t* dynamicOffsets = nullptr);
+	void pushConstants(VkPipelineLayout layout, VkShaderStageFlags stages, uint32_t offset, uint32_t size, const void* values);
+
+	// forgets everything bound, so the next command of every kind is emitted
+	void invalidate();
+	const Stats& getStats() const
+	{
+		return stats;
+	}
+private:
+	struct BindPointState
+	{
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		VkPipelineLayout setLayout = VK_NULL_HANDLE;
+		std::array<VkDescriptorSet, MAX_DESCRIPTOR_SETS> sets{};
+	};
+	static uint32_t bindPointIndex(VkPipelineBindPoint bindPoint);
+private:
+	VkCommandBuffer commandBuffer;
+	// graphics and compute
+	std::array<BindPointState, 2> bindPoints{};
+	std::array<VkBuffer, MAX_VERTEX_BINDINGS> vertexBuffers{};
+	std::array<VkDeviceSize, MAX_VERTEX_BINDINGS> vertexOffsets{};
+	VkBuffer indexBuffer = VK_NULL_HANDLE;
+	VkDeviceSize indexOffset = 0;
+	VkIndexType indexType = VK_INDEX_TYPE_MAX_ENUM;
+	VkPipelineLayout pushLayout = VK_NULL_HANDLE;
+	VkShaderStageFlags pushStages = 0;
+	std::array<uint8_t, MAX_PUSH_CONSTANT_SIZE> pushData{};
+	// the bytes of pushData that were pushed since the layout or stages last changed
+	std::bitset<MAX_PUSH_CONSTANT_SIZE> pushWritten;
+	Stats stats;
+};
@@ -0,0 +1,182 @@
+#include "DepthPyramid.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+DepthPyramid::DepthPyramid(EngineDevice& device, VkExtent2D depthExtent)
+	:
+	device(device),
+	depthExtent(depthExtent)
+{
+	createImage();
+	createPipeline();
+}
+
+DepthPyramid::~DepthPyramid()
+{
+	vkDestroyPipelineLayout(device.device(), pipelineLayout, nullptr);
+	vkDestroySampler(device.device(), sampler, nullptr);
+	for (VkImageView levelView : levelViews)
+	{
+		vkDestroyImageView(device.device(), levelView, nullptr);
+	}
+	vkDestroyImageView(device.device(), imageView, nullptr);
+	device.destroyImage(image, imageMemory);
+}
+
+void DepthPyramid::createImage()
+{
+	VkExtent2D extent{ std::max(depthExtent.width / 2, 1u), std::max(depthExtent.height / 2, 1u) };
+	levelExtents.push_back(extent);
+	while (extent.width > 1 || extent.height > 1)
+	{
+		extent = { std::max(extent.width / 2, 1u), std::max(extent.height / 2, 1u) };
+		levelExtents.push_back(extent);
+	}
+	const uint32_t levelCount = static_cast<uint32_t>(levelExtents.size());
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.extent = { levelExtents[0].width, levelExtents[0].height, 1 };
+	imageInfo.mipLevels = levelCount;
+	imageInfo.arrayLayers = 1;
+	imageInfo.format = VK_FORMAT_R32G32_SFLOAT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, imageMemory);
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = VK_FORMAT_R32G32_SFLOAT;
+	viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount, 0, 1 };
+	if (vkCreateImageView(device.device(), &viewInfo, nullptr, &imageView) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create depth pyramid image view!");
+	}
+	levelViews.resize(levelCount);
+	for (uint32_t level = 0; level < levelCount; level++)
+	{
+		viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1 };
+		if (vkCreateImageView(device.device(), &viewInfo, nullptr, &levelViews[level]) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create depth pyramid level view!");
+		}
+	}
+
+	VkSamplerCreateInfo samplerInfo{};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+	if (vkCreateSampler(device.device(), &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create depth pyramid sampler!");
+	}
+
+	// shaders may bind the pyramid before its first build, so it is never left undefined
+	VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount, 0, 1 };
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+		0, nullptr, 0, nullptr, 1, &barrier);
+	device.endSingleTimeCommands(commandBuffer);
+}
+
+void DepthPyramid::createPipeline()
+{
+	reduceSetLayout = DescriptorSetLayout::Builder(device)
+		.addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+		.addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT)
+		.build();
+	const uint32_t setCount = EngineSwapChain::MAX_FRAMES_IN_FLIGHT * getLevelCount();
+	descriptorPool = DescriptorPool::Builder(device)
+		.setMaxSets(setCount)
+		.addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, setCount)
+		.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, setCount)
+		.build();
+	reduceSets.resize(setCount);
+	for (VkDescriptorSet& set : reduceSets)
+	{
+		if (!descriptorPool->allocateDescriptor(reduceSetLayout->getDescriptorSetLayout(), set))
+		{
+			throw std::runtime_error("Failed to allocate depth pyramid descriptor set!");
+		}
+	}
+
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(ReducePushConstantData);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	const VkDescriptorSetLayout setLayout = reduceSetLayout->getDescriptorSetLayout();
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &setLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(device.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create depth pyramid pipelineLayout!");
+	}
+	reducePipeline = std::make_unique<Pipeline>(device, "Shaders/depth_pyramid.comp.spv", pipelineLayout);
+}
+
+void DepthPyramid::build(VkCommandBuffer commandBuffer, int frameIndex, VkImageView depthView)
+{
+	// the last frame's culling may still be reading the levels about to be overwritten
+	VkMemoryBarrier readBarrier{};
+	readBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+		1, &readBarrier, 0, nullptr, 0, nullptr);
+
+	reducePipeline->bind(commandBuffer);
+	for (uint32_t level = 0; level < getLevelCount(); level++)
+	{
+		// this frame's sets were last used by the frame whose fence was waited on
+		const VkDescriptorSet set = reduceSets[frameIndex * getLevelCount() + level];
+		const VkDescriptorImageInfo sourceInfo = level == 0
+			? VkDescriptorImageInfo{ sampler, depthView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL }
+			: VkDescriptorImageInfo{ sampler, levelViews[level - 1], VK_IMAGE_LAYOUT_GENERAL };
+		const VkDescriptorImageInfo destinationInfo{ VK_NULL_HANDLE, levelViews[level], VK_IMAGE_LAYOUT_GENERAL };
+		DescriptorWriter(*reduceSetLayout, *descriptorPool)
+			.writeImage(0, &sourceInfo)
+			.writeImage(1, &destinationInfo)
+			.overwrite(set);
+
+		ReducePushConstantData push{};
+		const VkExtent2D sourceExtent = level == 0 ? depthExtent : levelExtents[level - 1];
+		push.sourceSize = { static_cast<int>(sourceExtent.width), static_cast<int>(sourceExtent.height) };
+		push.sourceIsDepth = level == 0;
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &set, 0, nullptr);
+		vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ReducePushConstantData), &push);
+		vkCmdDispatch(commandBuffer, (levelExtents[level].width + GROUP_SIZE - 1) / GROUP_SIZE,
+			(levelExtents[level].height + GROUP_SIZE - 1) / GROUP_SIZE, 1);
+
+		// every level reads the one before, and culling reads them all
+		VkMemoryBarrier levelBarrier{};
+		levelBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		levelBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		levelBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+			1, &levelBarrier, 0, nullptr, 0, nullptr);
+	}
+}
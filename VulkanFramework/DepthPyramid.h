@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Descriptors.h"
+#include "EngineDevice.h"
+#include "EngineSwapChain.h"
+#include "Pipeline.h"
+#include <memory>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// Nearest and farthest depth of ever larger blocks of a depth buffer, for occlusion culling. Level 0 is half
+// the depth buffer in each dimension, rounded down, and every level halves the one before down to 1x1; texel t
+// covers texels 2t and 2t + 1 of the level below, and the last one also takes an odd leftover row or column.
+// Red is the nearest depth, green the farthest. The image stays in VK_IMAGE_LAYOUT_GENERAL.
+class DepthPyramid
+{
+	struct ReducePushConstantData
+	{
+		glm::ivec2 sourceSize;
+		uint32_t sourceIsDepth;
+	};
+	static constexpr uint32_t GROUP_SIZE = 8;
+public:
+	DepthPyramid(EngineDevice& device, VkExtent2D depthExtent);
+	~DepthPyramid();
+	DepthPyramid(const DepthPyramid&) = delete;
+	DepthPyramid& operator=(const DepthPyramid&) = delete;
+
+	// Reduces depthView, in VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, into every level and makes them
+	// visible to compute shaders. Recorded outside a render pass.
+	void build(VkCommandBuffer commandBuffer, int frameIndex, VkImageView depthView);
+
+	VkExtent2D getDepthExtent() const
+	{
+		return depthExtent;
+	}
+	uint32_t getLevelCount() const
+	{
+		return static_cast<uint32_t>(levelViews.size());
+	}
+	// every level, for texelFetch
+	VkDescriptorImageInfo getDescriptorInfo() const
+	{
+		return { sampler, imageView, VK_IMAGE_LAYOUT_GENERAL };
+	}
+private:
+	void createImage();
+	void createPipeline();
+private:
+	EngineDevice& device;
+	VkExtent2D depthExtent;
+	VkImage image;
+	MemoryAllocation imageMemory{};
+	VkImageView imageView;
+	std::vector<VkImageView> levelViews;
+	std::vector<VkExtent2D> levelExtents;
+	VkSampler sampler;
+	std::unique_ptr<DescriptorSetLayout> reduceSetLayout;
+	std::unique_ptr<DescriptorPool> descriptorPool;
+	// one set per level for every frame in flight, rewritten as the depth view changes
+	std::vector<VkDescriptorSet> reduceSets;
+	VkPipelineLayout pipelineLayout;
+	std::unique_ptr<Pipeline> reducePipeline;
+};
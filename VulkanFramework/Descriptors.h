@@ -0,0 +1,95 @@
+#pragma once
+
+#include "EngineDevice.h"
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class DescriptorSetLayout
+{
+public:
+	class Builder
+	{
+	public:
+		Builder(EngineDevice& device)
+			:
+			device(device)
+		{}
+
+		Builder& addBinding(uint32_t binding, VkDescriptorType descriptorType, VkShaderStageFlags stageFlags, uint32_t count = 1);
+		std::unique_ptr<DescriptorSetLayout> build() const;
+	private:
+		EngineDevice& device;
+		std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings;
+	};
+public:
+	DescriptorSetLayout(EngineDevice& device, const std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding>& bindings);
+	~DescriptorSetLayout();
+	DescriptorSetLayout(const DescriptorSetLayout&) = delete;
+	DescriptorSetLayout& operator=(const DescriptorSetLayout&) = delete;
+
+	VkDescriptorSetLayout getDescriptorSetLayout() const
+	{
+		return descriptorSetLayout;
+	}
+private:
+	EngineDevice& device;
+	VkDescriptorSetLayout descriptorSetLayout;
+	std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings;
+
+	friend class DescriptorWriter;
+};
+
+class DescriptorPool
+{
+public:
+	class Builder
+	{
+	public:
+		Builder(EngineDevice& device)
+			:
+			device(device)
+		{}
+
+		Builder& addPoolSize(VkDescriptorType descriptorType, uint32_t count);
+		Builder& setPoolFlags(VkDescriptorPoolCreateFlags flags);
+		Builder& setMaxSets(uint32_t count);
+		std::unique_ptr<DescriptorPool> build() const;
+	private:
+		EngineDevice& device;
+		std::vector<VkDescriptorPoolSize> poolSizes;
+		uint32_t maxSets = 1000;
+		VkDescriptorPoolCreateFlags poolFlags = 0;
+	};
+public:
+	DescriptorPool(EngineDevice& device, uint32_t maxSets, VkDescriptorPoolCreateFlags poolFlags, const std::vector<VkDescriptorPoolSize>& poolSizes);
+	~DescriptorPool();
+	DescriptorPool(const DescriptorPool&) = delete;
+	DescriptorPool& operator=(const DescriptorPool&) = delete;
+
+	bool allocateDescriptor(VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet& descriptor) const;
+	void resetPool();
+private:
+	EngineDevice& device;
+	VkDescriptorPool descriptorPool;
+
+	friend class DescriptorWriter;
+};
+
+// Collects buffer and image writes for one set, then allocates it from the pool or rewrites an existing one.
+// The info structs are referenced, not copied, so they must outlive build or overwrite.
+class DescriptorWriter
+{
+public:
+	DescriptorWriter(DescriptorSetLayout& setLayout, DescriptorPool& pool);
+
+	DescriptorWriter& writeBuffer(uint32_t binding, const VkDescriptorBufferInfo* bufferInfo);
+	DescriptorWriter& writeImage(uint32_t binding, const VkDescriptorImageInfo* imageInfo);
+
+	bool build(VkDescriptorSet& set);
+	void overwrite(VkDescriptorSet set);
+private:
+	DescriptorSetLayout& setLayout;
+	DescriptorPool& pool;
+	std::vector<VkWriteDescriptorSet> writes;
+};
@@ -0,0 +1,88 @@
+#include "DrawList.h"
+
+#include <array>
+#include <cassert>
+#include <cstring>
+
+uint64_t DrawList::makeKey(Pass pass, uint32_t pipeline, uint32_t model, uint32_t lod, uint32_t material, float viewDepth)
+{
+	assert(pipeline < MAX_PIPELINES && model < MAX_MODELS && lod < MAX_LODS && "Draw does not fit a sort key!");
+
+	// non negative floats order like their bits, whose top 24 keep 15 mantissa bits
+	uint32_t depthBits = 0;
+	if (viewDepth > 0.0f)
+	{
+		memcpy(&depthBits, &viewDepth, sizeof(float));
+	}
+	uint64_t depth = depthBits >> 8;
+	if (pass == Pass::Blended)
+	{
+		depth = DEPTH_MASK - depth;
+	}
+	return (static_cast<uint64_t>(pass) << PASS_SHIFT) |
+		(static_cast<uint64_t>(pipeline) << PIPELINE_SHIFT) |
+		(static_cast<uint64_t>(model) << MODEL_SHIFT) |
+		(static_cast<uint64_t>(lod) << LOD_SHIFT) |
+		(static_cast<uint64_t>(material % MAX_MATERIALS) << MATERIAL_SHIFT) |
+		depth;
+}
+
+void DrawList::clear()
+{
+	keys.clear();
+	items.clear();
+}
+
+void DrawList::reserve(size_t count)
+{
+	keys.reserve(count);
+	items.reserve(count);
+	sortedKeys.reserve(count);
+	sortedItems.reserve(count);
+}
+
+void DrawList::sort()
+{
+	if (keys.size() < 2)
+	{
+		return;
+	}
+
+	// every pass's histogram in one read of the keys
+	std::array<std::array<uint32_t, 256>, 8> counts{};
+	for (uint64_t key : keys)
+	{
+		for (uint32_t pass = 0; pass < 8; pass++)
+		{
+			counts[pass][(key >> (pass * 8)) & 0xFF]++;
+		}
+	}
+
+	sortedKeys.resize(keys.size());
+	sortedItems.resize(items.size());
+	for (uint32_t pass = 0; pass < 8; pass++)
+	{
+		std::array<uint32_t, 256>& offsets = counts[pass];
+		const uint32_t shift = pass * 8;
+		if (offsets[(keys.front() >> shift) & 0xFF] == keys.size())
+		{
+			continue;
+		}
+
+		uint32_t offset = 0;
+		for (uint32_t& count : offsets)
+		{
+			const uint32_t digitCount = count;
+			count = offset;
+			offset += digitCount;
+		}
+		for (size_t k = 0; k < keys.size(); k++)
+		{
+			const uint32_t position = offsets[(keys[k] >> shift) & 0xFF]++;
+			sortedKeys[position] = keys[k];
+			sortedItems[position] = items[k];
+		}
+		keys.swap(sortedKeys);
+		items.swap(sortedItems);
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Draws as 64 bit sort keys, most significant first: pass, pipeline, model, LOD, material and quantized
+// view depth, front to back for opaque draws and back to front for blended ones. Sorting groups every
+// model and LOD into one run for an instanced draw and orders the runs so binds change as rarely as possible.
+// Materials are a per object index rather than bound state, so they only order the instances of a run.
+class DrawList
+{
+public:
+	enum class Pass : uint32_t
+	{
+		Opaque,
+		Blended
+	};
+	// state changes recording the list would take, with redundant ones skipped
+	struct Stats
+	{
+		uint32_t pipelineBinds = 0;
+		uint32_t geometryBinds = 0;
+		uint32_t pushConstants = 0;
+		uint32_t draws = 0;
+	};
+	static constexpr uint32_t PASS_SHIFT = 62;
+	static constexpr uint32_t PIPELINE_SHIFT = 58;
+	static constexpr uint32_t MODEL_SHIFT = 42;
+	static constexpr uint32_t LOD_SHIFT = 38;
+	static constexpr uint32_t MATERIAL_SHIFT = 24;
+	static constexpr uint32_t MAX_PIPELINES = 1u << (PASS_SHIFT - PIPELINE_SHIFT);
+	static constexpr uint32_t MAX_MODELS = 1u << (PIPELINE_SHIFT - MODEL_SHIFT);
+	static constexpr uint32_t MAX_LODS = 1u << (MODEL_SHIFT - LOD_SHIFT);
+	static constexpr uint32_t MAX_MATERIALS = 1u << (LOD_SHIFT - MATERIAL_SHIFT);
+	static constexpr uint64_t DEPTH_MASK = (1ull << MATERIAL_SHIFT) - 1;
+public:
+	DrawList() = default;
+	DrawList(const DrawList&) = delete;
+	DrawList& operator=(const DrawList&) = delete;
+
+	// viewDepth is the distance along the view direction; anything behind the camera sorts as 0
+	static uint64_t makeKey(Pass pass, uint32_t pipeline, uint32_t model, uint32_t lod, uint32_t material, float viewDepth);
+	// whether two keys are drawn by the same instanced draw
+	static bool sameDraw(uint64_t a, uint64_t b)
+	{
+		return (a >> LOD_SHIFT) == (b >> LOD_SHIFT);
+	}
+	static uint32_t getModel(uint64_t key)
+	{
+		return static_cast<uint32_t>(key >> MODEL_SHIFT) & (MAX_MODELS - 1);
+	}
+	static uint32_t getLod(uint64_t key)
+	{
+		return static_cast<uint32_t>(key >> LOD_SHIFT) & (MAX_LODS - 1);
+	}
+
+	void clear();
+	void reserve(size_t count);
+	void add(uint64_t key, uint32_t item)
+	{
+		keys.push_back(key);
+		items.push_back(item);
+	}
+	// Stable LSD radix sort of the keys, a byte per pass; passes where every key has the same byte are skipped.
+	void sort();
+
+	size_t size() const
+	{
+		return keys.size();
+	}
+	bool empty() const
+	{
+		return keys.empty();
+	}
+	uint64_t getKey(size_t k) const
+	{
+		return keys[k];
+	}
+	uint32_t getItem(size_t k) const
+	{
+		return items[k];
+	}
+private:
+	std::vector<uint64_t> keys;
+	std::vector<uint32_t> items;
+	std::vector<uint64_t> sortedKeys;
+	std::vector<uint32_t> sortedItems;
+};
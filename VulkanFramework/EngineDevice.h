@@ -1,11 +1,16 @@
 #pragma once
 
 #include "Window.h"
+#include "MemoryAllocator.h"
 
 // std lib headers
+#include <memory>
 #include <string>
 #include <vector>
 
+class StagingRing;
+class UploadService;
+
 struct SwapChainSupportDetails {
   VkSurfaceCapabilitiesKHR capabilities;
   std::vector<VkSurfaceFormatKHR> formats;
@@ -15,11 +20,24 @@ struct SwapChainSupportDetails {
 struct QueueFamilyIndices {
   uint32_t graphicsFamily;
   uint32_t presentFamily;
+  // a transfer-only family when the device has one, the graphics family otherwise
+  uint32_t transferFamily;
   bool graphicsFamilyHasValue = false;
   bool presentFamilyHasValue = false;
+  bool transferFamilyHasValue = false;
   bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
 };
 
+// Optional features the renderer uses, enabled whenever the device has them.
+struct OptionalFeatures {
+  bool multiDrawIndirect = false;
+  bool drawIndirectFirstInstance = false;
+  // vkCmdDrawIndexedIndirectCount, core in Vulkan 1.2 but still optional
+  bool drawIndirectCount = false;
+  // storage images of two channel formats such as rg32f
+  bool shaderStorageImageExtendedFormats = false;
+};
+
 class EngineDevice
 {
  public:
@@ -43,6 +61,10 @@ class EngineDevice
   VkSurfaceKHR surface() { return surface_; }
   VkQueue graphicsQueue() { return graphicsQueue_; }
   VkQueue presentQueue() { return presentQueue_; }
+  VkQueue transferQueue() { return transferQueue_; }
+  MemoryAllocator &allocator() { return *allocator_; }
+  StagingRing &stagingRing() { return *stagingRing_; }
+  UploadService &uploadService() { return *uploadService_; }
 
   SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
   uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
@@ -56,10 +78,16 @@ class EngineDevice
       VkBufferUsageFlags usage,
       VkMemoryPropertyFlags properties,
       VkBuffer &buffer,
-      VkDeviceMemory &bufferMemory);
+      MemoryAllocation &bufferMemory);
+  void destroyBuffer(VkBuffer buffer, MemoryAllocation &bufferMemory);
   VkCommandBuffer beginSingleTimeCommands();
   void endSingleTimeCommands(VkCommandBuffer commandBuffer);
-  void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+  void copyBuffer(
+      VkBuffer srcBuffer,
+      VkBuffer dstBuffer,
+      VkDeviceSize size,
+      VkDeviceSize srcOffset = 0,
+      VkDeviceSize dstOffset = 0);
   void copyBufferToImage(
       VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
 
@@ -67,9 +95,11 @@ class EngineDevice
       const VkImageCreateInfo &imageInfo,
       VkMemoryPropertyFlags properties,
       VkImage &image,
-      VkDeviceMemory &imageMemory);
+      MemoryAllocation &imageMemory);
+  void destroyImage(VkImage image, MemoryAllocation &imageMemory);
 
   VkPhysicalDeviceProperties properties;
+  OptionalFeatures optionalFeatures;
 
  private:
   void createInstance();
@@ -99,6 +129,10 @@ class EngineDevice
   VkSurfaceKHR surface_;
   VkQueue graphicsQueue_;
   VkQueue presentQueue_;
+  VkQueue transferQueue_;
+  std::unique_ptr<MemoryAllocator> allocator_;
+  std::unique_ptr<StagingRing> stagingRing_;
+  std::unique_ptr<UploadService> uploadService_;
 
   const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
   const std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
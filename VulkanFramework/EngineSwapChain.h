@@ -6,10 +6,21 @@
 #include <vulkan/vulkan.h>
 
 // std lib headers
+#include <array>
 #include <memory>
 #include <string>
 #include <vector>
 
+// The swap chain's render passes are compatible, so pipelines and framebuffers work with any of them.
+enum class SwapChainPass {
+  // clears the attachments and presents
+  Whole,
+  // clears the attachments and leaves depth readable by shaders, for a Resume pass to finish
+  KeepDepth,
+  // loads what a KeepDepth pass left and presents
+  Resume
+};
+
 class EngineSwapChain {
  public:
     static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
@@ -22,8 +33,11 @@ class EngineSwapChain {
     EngineSwapChain& operator=(const EngineSwapChain &) = delete;
     
     VkFramebuffer getFrameBuffer(int index) { return swapChainFramebuffers[index]; }
-    VkRenderPass getRenderPass() { return renderPass; }
+    VkRenderPass getRenderPass(SwapChainPass pass = SwapChainPass::Whole) {
+      return renderPasses[static_cast<size_t>(pass)];
+    }
     VkImageView getImageView(int index) { return swapChainImageViews[index]; }
+    VkImageView getDepthImageView(int index) { return depthImageViews[index]; }
     size_t imageCount() { return swapChainImages.size(); }
     VkFormat getSwapChainImageFormat() { return swapChainImageFormat; }
     VkExtent2D getSwapChainExtent() { return swapChainExtent; }
@@ -36,7 +50,9 @@ class EngineSwapChain {
     VkFormat findDepthFormat();
     
     VkResult acquireNextImage(uint32_t *imageIndex);
-    VkResult submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex);
+    // uploadWaitValue is a value of the upload timeline semaphore the submission waits for, 0 for none
+    VkResult submitCommandBuffers(
+        const VkCommandBuffer *buffers, uint32_t *imageIndex, uint64_t uploadWaitValue = 0);
 
     bool compareSwapFormats(const EngineSwapChain& swapChain) const
     {
@@ -50,6 +66,7 @@ class EngineSwapChain {
     void createImageViews();
     void createDepthResources();
     void createRenderPass();
+    VkRenderPass createRenderPass(SwapChainPass pass);
     void createFramebuffers();
     void createSyncObjects();
 
@@ -65,10 +82,10 @@ class EngineSwapChain {
     VkExtent2D swapChainExtent;
 
     std::vector<VkFramebuffer> swapChainFramebuffers;
-    VkRenderPass renderPass;
+    std::array<VkRenderPass, 3> renderPasses;
 
     std::vector<VkImage> depthImages;
-    std::vector<VkDeviceMemory> depthImageMemorys;
+    std::vector<MemoryAllocation> depthImageMemorys;
     std::vector<VkImageView> depthImageViews;
     std::vector<VkImage> swapChainImages;
     std::vector<VkImageView> swapChainImageViews;
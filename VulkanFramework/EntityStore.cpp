@@ -0,0 +1,325 @@
+#include "EntityStore.h"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace
+{
+	// matches no handle's generation
+	constexpr uint32_t RETIRED_SLOT = ~0u;
+}
+
+Entity EntityStore::create()
+{
+	uint32_t slot;
+	if (!freeSlots.empty())
+	{
+		slot = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else
+	{
+		if (slotGenerations.size() > Entity::INDEX_MASK)
+		{
+			throw std::runtime_error("Too many entities!");
+		}
+		slot = static_cast<uint32_t>(slotGenerations.size());
+		slotGenerations.push_back(0);
+		slotDenseIndices.push_back(0);
+	}
+
+	const Entity entity{ (slotGenerations[slot] << Entity::INDEX_BITS) | slot };
+	slotDenseIndices[slot] = size();
+	entities.push_back(entity);
+	transforms.emplace_back();
+	models.push_back(NO_MODEL);
+	colors.emplace_back(1.0f);
+	materials.push_back(0);
+	lods.push_back(0);
+	hierarchy.emplace_back();
+	worldMatrices.emplace_back(1.0f);
+	worldNormalMatrices.emplace_back(1.0f);
+	worldVersions.push_back(0);
+	worldStale.push_back(true);
+	anyWorldStale = true;
+	hierarchyChanged = true;
+	return entity;
+}
+
+void EntityStore::destroy(Entity entity)
+{
+	// children stay alive as roots
+	unlink(entity);
+	for (Entity child = hierarchy[denseIndex(entity)].firstChild; child != Entity{};)
+	{
+		HierarchyComponent& childHierarchy = hierarchy[denseIndex(child)];
+		const Entity next = childHierarchy.nextSibling;
+		childHierarchy.parent = {};
+		childHierarchy.nextSibling = {};
+		childHierarchy.previousSibling = {};
+		worldStale[denseIndex(child)] = true;
+		anyWorldStale = true;
+		child = next;
+	}
+
+	const uint32_t index = denseIndex(entity);
+	const uint32_t last = size() - 1;
+
+	// the last entity fills the hole
+	entities[index] = entities[last];
+	transforms[index] = transforms[last];
+	models[index] = models[last];
+	colors[index] = colors[last];
+	materials[index] = materials[last];
+	lods[index] = lods[last];
+	hierarchy[index] = hierarchy[last];
+	worldMatrices[index] = worldMatrices[last];
+	worldNormalMatrices[index] = worldNormalMatrices[last];
+	worldVersions[index] = worldVersions[last];
+	worldStale[index] = worldStale[last];
+	slotDenseIndices[entities[index].index()] = index;
+
+	entities.pop_back();
+	transforms.pop_back();
+	models.pop_back();
+	colors.pop_back();
+	materials.pop_back();
+	lods.pop_back();
+	hierarchy.pop_back();
+	worldMatrices.pop_back();
+	worldNormalMatrices.pop_back();
+	worldVersions.pop_back();
+	worldStale.pop_back();
+	hierarchyChanged = true;
+
+	// a slot out of generations is retired rather than handing out a handle equal to an old one
+	const uint32_t slot = entity.index();
+	if (slotGenerations[slot] == Entity::MAX_GENERATION)
+	{
+		slotGenerations[slot] = RETIRED_SLOT;
+	}
+	else
+	{
+		slotGenerations[slot]++;
+		freeSlots.push_back(slot);
+	}
+}
+
+bool EntityStore::isAlive(Entity entity) const
+{
+	return entity.index() < slotGenerations.size() && slotGenerations[entity.index()] == entity.generation();
+}
+
+void EntityStore::reserve(size_t count)
+{
+	slotGenerations.reserve(count);
+	slotDenseIndices.reserve(count);
+	entities.reserve(count);
+	transforms.reserve(count);
+	models.reserve(count);
+	colors.reserve(count);
+	materials.reserve(count);
+	lods.reserve(count);
+	hierarchy.reserve(count);
+	worldMatrices.reserve(count);
+	worldNormalMatrices.reserve(count);
+	worldVersions.reserve(count);
+	worldStale.reserve(count);
+}
+
+void EntityStore::setParent(Entity child, Entity parent)
+{
+	for (Entity ancestor = parent; ancestor != Entity{}; ancestor = hierarchy[denseIndex(ancestor)].parent)
+	{
+		if (ancestor == child)
+		{
+			throw std::runtime_error("Entity cannot be parented to itself or its descendants!");
+		}
+	}
+
+	unlink(child);
+	if (parent != Entity{})
+	{
+		HierarchyComponent& parentHierarchy = hierarchy[denseIndex(parent)];
+		HierarchyComponent& childHierarchy = hierarchy[denseIndex(child)];
+		childHierarchy.parent = parent;
+		childHierarchy.nextSibling = parentHierarchy.firstChild;
+		if (parentHierarchy.firstChild != Entity{})
+		{
+			hierarchy[denseIndex(parentHierarchy.firstChild)].previousSibling = child;
+		}
+		parentHierarchy.firstChild = child;
+	}
+	worldStale[denseIndex(child)] = true;
+	anyWorldStale = true;
+	hierarchyChanged = true;
+}
+
+void EntityStore::updateTransforms(ThreadPool* threadPool)
+{
+	staleTransforms.clear();
+	transformBatch.clear();
+	for (uint32_t i = 0; i < size(); i++)
+	{
+		const TransformComponent& transform = transforms[i];
+		if (transform.dirty)
+		{
+			staleTransforms.push_back(i);
+			transformBatch.push(transform.translation, transform.rotation, transform.scale);
+		}
+		// a transform whose cache was already refreshed by reading it still moved
+		if (transform.version != worldVersions[i])
+		{
+			worldVersions[i] = transform.version;
+			worldStale[i] = true;
+			anyWorldStale = true;
+		}
+	}
+	if (!staleTransforms.empty())
+	{
+		batchMatrices.resize(staleTransforms.size());
+		batchNormalMatrices.resize(staleTransforms.size());
+		TransformKernel::compute(transformBatch, batchMatrices.data(), batchNormalMatrices.data());
+		for (size_t k = 0; k < staleTransforms.size(); k++)
+		{
+			TransformComponent& transform = transforms[staleTransforms[k]];
+			transform.matrix = batchMatrices[k];
+			transform.normal = batchNormalMatrices[k];
+			transform.dirty = false;
+		}
+	}
+
+	if (!anyWorldStale)
+	{
+		return;
+	}
+	if (hierarchyChanged)
+	{
+		buildHierarchyOrder();
+	}
+	worldChanged.resize(hierarchyOrder.size());
+
+	// Parents are a level above their children, so every level only reads finished matrices
+	// and its nodes can be updated in any order.
+	for (size_t level = 0; level + 1 < levelOffsets.size(); level++)
+	{
+		const size_t begin = levelOffsets[level];
+		const size_t end = levelOffsets[level + 1];
+		if (threadPool && threadPool->getThreadCount() > 1 && end - begin >= PARALLEL_MIN_NODES)
+		{
+			const size_t rangeCount = threadPool->getThreadCount() * 4;
+			threadPool->parallelFor(rangeCount, [&](size_t range)
+			{
+				updateWorldMatrices(begin + (end - begin) * range / rangeCount, begin + (end - begin) * (range + 1) / rangeCount);
+			});
+		}
+		else
+		{
+			updateWorldMatrices(begin, end);
+		}
+	}
+	anyWorldStale = false;
+}
+
+EntityStore::ModelHandle EntityStore::addModel(std::shared_ptr<Model> model)
+{
+	if (modelTable.size() >= maxModels)
+	{
+		throw std::runtime_error("Too many models!");
+	}
+	modelTable.push_back(std::move(model));
+	return static_cast<ModelHandle>(modelTable.size() - 1);
+}
+
+void EntityStore::unlink(Entity entity)
+{
+	HierarchyComponent& entityHierarchy = hierarchy[denseIndex(entity)];
+	if (entityHierarchy.parent == Entity{})
+	{
+		return;
+	}
+
+	if (entityHierarchy.previousSibling != Entity{})
+	{
+		hierarchy[denseIndex(entityHierarchy.previousSibling)].nextSibling = entityHierarchy.nextSibling;
+	}
+	else
+	{
+		hierarchy[denseIndex(entityHierarchy.parent)].firstChild = entityHierarchy.nextSibling;
+	}
+	if (entityHierarchy.nextSibling != Entity{})
+	{
+		hierarchy[denseIndex(entityHierarchy.nextSibling)].previousSibling = entityHierarchy.previousSibling;
+	}
+	entityHierarchy.parent = {};
+	entityHierarchy.nextSibling = {};
+	entityHierarchy.previousSibling = {};
+}
+
+void EntityStore::buildHierarchyOrder()
+{
+	hierarchyOrder.clear();
+	levelOffsets.clear();
+
+	for (uint32_t i = 0; i < size(); i++)
+	{
+		if (hierarchy[i].parent == Entity{})
+		{
+			hierarchyOrder.push_back({ i, NO_PARENT, NO_PARENT });
+		}
+	}
+
+	// every level is the children of the one before it, in order
+	size_t levelBegin = 0;
+	while (levelBegin < hierarchyOrder.size())
+	{
+		levelOffsets.push_back(static_cast<uint32_t>(levelBegin));
+		const size_t levelEnd = hierarchyOrder.size();
+		for (size_t position = levelBegin; position < levelEnd; position++)
+		{
+			const uint32_t parentIndex = hierarchyOrder[position].denseIndex;
+			for (Entity child = hierarchy[parentIndex].firstChild; child != Entity{}; child = hierarchy[denseIndex(child)].nextSibling)
+			{
+				hierarchyOrder.push_back({ denseIndex(child), parentIndex, static_cast<uint32_t>(position) });
+			}
+		}
+		levelBegin = levelEnd;
+	}
+	levelOffsets.push_back(static_cast<uint32_t>(hierarchyOrder.size()));
+	hierarchyChanged = false;
+}
+
+void EntityStore::updateWorldMatrices(size_t begin, size_t end)
+{
+	for (size_t position = begin; position < end; position++)
+	{
+		const HierarchyNode& node = hierarchyOrder[position];
+		const TransformComponent& transform = transforms[node.denseIndex];
+		const bool parentChanged = node.parentPosition != NO_PARENT && worldChanged[node.parentPosition];
+		const bool changed = parentChanged || worldStale[node.denseIndex];
+		worldChanged[position] = changed;
+		if (!changed)
+		{
+			continue;
+		}
+
+		if (node.parentPosition == NO_PARENT)
+		{
+			worldMatrices[node.denseIndex] = transform.mat4();
+			worldNormalMatrices[node.denseIndex] = transform.normalMatrix();
+		}
+		else
+		{
+			// the inverse transpose of a product is the product of the inverse transposes
+			worldMatrices[node.denseIndex] = worldMatrices[node.parentDenseIndex] * transform.mat4();
+			worldNormalMatrices[node.denseIndex] = worldNormalMatrices[node.parentDenseIndex] * transform.normalMatrix();
+		}
+		worldStale[node.denseIndex] = false;
+	}
+}
+
+uint32_t EntityStore::denseIndex(Entity entity) const
+{
+	assert(isAlive(entity) && "Entity is not alive!");
+	return slotDenseIndices[entity.index()];
+}
@@ -0,0 +1,193 @@
+#pragma once
+
+#include "Model.h"
+#include "ThreadPool.h"
+#include "TransformComponent.h"
+#include "TransformKernel.h"
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+// Slot index in the low 24 bits and the slot's generation in the high 8. Destroying an entity bumps
+// its slot's generation, so handles to it stop resolving even after the slot is reused.
+struct Entity
+{
+	static constexpr uint32_t INDEX_BITS = 24;
+	static constexpr uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+	static constexpr uint32_t INVALID = ~0u;
+	// the last generation is left out so no live entity's handle equals INVALID
+	static constexpr uint32_t MAX_GENERATION = (INVALID >> INDEX_BITS) - 1;
+
+	uint32_t id = INVALID;
+
+	uint32_t index() const
+	{
+		return id & INDEX_MASK;
+	}
+	uint32_t generation() const
+	{
+		return id >> INDEX_BITS;
+	}
+	bool operator==(const Entity&) const = default;
+};
+
+// Entities with their components in parallel, densely packed arrays: the i-th element of every
+// component array belongs to the i-th live entity, so systems walk them as plain contiguous spans.
+// Destroying moves the last entity into the hole, which keeps the arrays dense but does not keep
+// their order. Models are shared through handles into the store's model table.
+// Entities can be parented to others; their transform is then relative to the parent's world matrix.
+class EntityStore
+{
+	struct HierarchyComponent
+	{
+		Entity parent;
+		Entity firstChild;
+		Entity nextSibling;
+		Entity previousSibling;
+	};
+	// an entity in breadth first order, every parent comes before its children
+	struct HierarchyNode
+	{
+		uint32_t denseIndex;
+		uint32_t parentDenseIndex;
+		uint32_t parentPosition;
+	};
+	static constexpr uint32_t NO_PARENT = ~0u;
+	// levels smaller than this are not worth splitting across threads
+	static constexpr size_t PARALLEL_MIN_NODES = 4096;
+public:
+	using ModelHandle = uint32_t;
+	static constexpr ModelHandle NO_MODEL = ~0u;
+public:
+	// addModel throws past maxModels, for renderers that pack model handles into fewer bits
+	explicit EntityStore(uint32_t maxModels = NO_MODEL)
+		:
+		maxModels(maxModels)
+	{}
+	EntityStore(const EntityStore&) = delete;
+	EntityStore& operator=(const EntityStore&) = delete;
+
+	Entity create();
+	void destroy(Entity entity);
+	bool isAlive(Entity entity) const;
+	void reserve(size_t count);
+	// Attaches child under parent, or makes it a root when parent is a default Entity.
+	// Throws when parent is child itself or one of its descendants.
+	void setParent(Entity child, Entity parent);
+	Entity getParent(Entity entity) const
+	{
+		return hierarchy[denseIndex(entity)].parent;
+	}
+	// Rebuilds the cached local matrices of every changed transform in one batch, then the world
+	// matrices of the changed subtrees, level by level. Levels are split across threadPool if given.
+	void updateTransforms(ThreadPool* threadPool = nullptr);
+
+	ModelHandle addModel(std::shared_ptr<Model> model);
+	Model& getModel(ModelHandle handle) const
+	{
+		return *modelTable[handle];
+	}
+	// handles are [0, getModelCount())
+	uint32_t getModelCount() const
+	{
+		return static_cast<uint32_t>(modelTable.size());
+	}
+
+	// Components of one live entity. References are invalidated by create and destroy.
+	TransformComponent& transform(Entity entity)
+	{
+		return transforms[denseIndex(entity)];
+	}
+	ModelHandle& model(Entity entity)
+	{
+		return models[denseIndex(entity)];
+	}
+	// tints the model's vertex colors, white by default
+	glm::vec3& color(Entity entity)
+	{
+		return colors[denseIndex(entity)];
+	}
+	uint32_t& material(Entity entity)
+	{
+		return materials[denseIndex(entity)];
+	}
+
+	uint32_t size() const
+	{
+		return static_cast<uint32_t>(entities.size());
+	}
+	std::span<const Entity> getEntities() const
+	{
+		return entities;
+	}
+	std::span<TransformComponent> getTransforms()
+	{
+		return transforms;
+	}
+	std::span<const ModelHandle> getModels() const
+	{
+		return models;
+	}
+	std::span<const glm::vec3> getColors() const
+	{
+		return colors;
+	}
+	std::span<const uint32_t> getMaterials() const
+	{
+		return materials;
+	}
+	// as of the last updateTransforms
+	std::span<const glm::mat4> getWorldMatrices() const
+	{
+		return worldMatrices;
+	}
+	std::span<const glm::mat3> getWorldNormalMatrices() const
+	{
+		return worldNormalMatrices;
+	}
+	// LOD drawn last frame, kept so switching can lag behind the threshold
+	std::span<uint32_t> getLods()
+	{
+		return lods;
+	}
+private:
+	uint32_t denseIndex(Entity entity) const;
+	void unlink(Entity entity);
+	void buildHierarchyOrder();
+	void updateWorldMatrices(size_t begin, size_t end);
+private:
+	// per slot, the current generation and where its entity lives in the dense arrays
+	std::vector<uint32_t> slotGenerations;
+	std::vector<uint32_t> slotDenseIndices;
+	std::vector<uint32_t> freeSlots;
+
+	std::vector<Entity> entities;
+	std::vector<TransformComponent> transforms;
+	std::vector<ModelHandle> models;
+	std::vector<glm::vec3> colors;
+	std::vector<uint32_t> materials;
+	std::vector<uint32_t> lods;
+	std::vector<HierarchyComponent> hierarchy;
+	std::vector<glm::mat4> worldMatrices;
+	std::vector<glm::mat3> worldNormalMatrices;
+	// transform version the world matrix was built from, and whether the parent changed since
+	std::vector<uint32_t> worldVersions;
+	std::vector<uint8_t> worldStale;
+
+	std::vector<std::shared_ptr<Model>> modelTable;
+	uint32_t maxModels;
+
+	std::vector<uint32_t> staleTransforms;
+	TransformKernel::Batch transformBatch;
+	std::vector<glm::mat4> batchMatrices;
+	std::vector<glm::mat3> batchNormalMatrices;
+
+	std::vector<HierarchyNode> hierarchyOrder;
+	// where each depth starts in hierarchyOrder, plus the end
+	std::vector<uint32_t> levelOffsets;
+	// per position in hierarchyOrder, whether the world matrix was rebuilt this update
+	std::vector<uint8_t> worldChanged;
+	bool hierarchyChanged = false;
+	bool anyWorldStale = false;
+};
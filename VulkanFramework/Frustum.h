@@ -0,0 +1,31 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+struct Frustum
+{
+	// left, right, bottom, top, near, far; xyz is the inward unit normal and w the distance,
+	// so a point is inside a plane when dot(xyz, point) + w >= 0
+	glm::vec4 planes[6]{};
+
+	// Clip planes of a projection * view matrix (Gribb and Hartmann), z clips to [0, w].
+	// Planes of projection * view * model are the frustum in that model's space.
+	static Frustum fromMatrix(const glm::mat4& m)
+	{
+		auto row = [&](int i)
+		{
+			return glm::vec4{ m[0][i], m[1][i], m[2][i], m[3][i] };
+		};
+		Frustum frustum{ {
+			row(3) + row(0), row(3) - row(0),
+			row(3) + row(1), row(3) - row(1),
+			row(2), row(3) - row(2) } };
+		for (glm::vec4& plane : frustum.planes)
+		{
+			plane /= glm::length(glm::vec3(plane));
+		}
+		return frustum;
+	}
+};
@@ -0,0 +1,156 @@
+#include "FrustumCuller.h"
+
+#include <bit>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FRUSTUM_CULLER_SSE
+#include <xmmintrin.h>
+#endif
+
+void FrustumCuller::clear()
+{
+	for (std::vector<float>* values : arrays())
+	{
+		values->clear();
+	}
+	count = 0;
+}
+
+void FrustumCuller::reserve(size_t capacity)
+{
+	// room for the padding of the last group of four as well
+	const size_t padded = (capacity + 3) & ~size_t{ 3 };
+	for (std::vector<float>* values : arrays())
+	{
+		values->reserve(padded);
+	}
+}
+
+void FrustumCuller::add(const BoundingSphere& sphere, const BoundingBox& box)
+{
+	const glm::vec3 center = box.center();
+	const glm::vec3 extent = box.extent();
+	sphereX.push_back(sphere.center.x);
+	sphereY.push_back(sphere.center.y);
+	sphereZ.push_back(sphere.center.z);
+	sphereRadius.push_back(sphere.radius);
+	boxX.push_back(center.x);
+	boxY.push_back(center.y);
+	boxZ.push_back(center.z);
+	extentX.push_back(extent.x);
+	extentY.push_back(extent.y);
+	extentZ.push_back(extent.z);
+	count++;
+}
+
+void FrustumCuller::cull(const Frustum& frustum, std::vector<uint32_t>& visible)
+{
+	visible.clear();
+	pad();
+
+#ifdef FRUSTUM_CULLER_SSE
+	__m128 normalX[6], normalY[6], normalZ[6], distance[6], absNormalX[6], absNormalY[6], absNormalZ[6];
+	for (int p = 0; p < 6; p++)
+	{
+		const glm::vec4& plane = frustum.planes[p];
+		normalX[p] = _mm_set1_ps(plane.x);
+		normalY[p] = _mm_set1_ps(plane.y);
+		normalZ[p] = _mm_set1_ps(plane.z);
+		distance[p] = _mm_set1_ps(plane.w);
+		absNormalX[p] = _mm_set1_ps(std::abs(plane.x));
+		absNormalY[p] = _mm_set1_ps(std::abs(plane.y));
+		absNormalZ[p] = _mm_set1_ps(std::abs(plane.z));
+	}
+
+	for (uint32_t i = 0; i < count; i += 4)
+	{
+		const __m128 sx = _mm_loadu_ps(&sphereX[i]);
+		const __m128 sy = _mm_loadu_ps(&sphereY[i]);
+		const __m128 sz = _mm_loadu_ps(&sphereZ[i]);
+		const __m128 sr = _mm_loadu_ps(&sphereRadius[i]);
+		const __m128 bx = _mm_loadu_ps(&boxX[i]);
+		const __m128 by = _mm_loadu_ps(&boxY[i]);
+		const __m128 bz = _mm_loadu_ps(&boxZ[i]);
+		const __m128 ex = _mm_loadu_ps(&extentX[i]);
+		const __m128 ey = _mm_loadu_ps(&extentY[i]);
+		const __m128 ez = _mm_loadu_ps(&extentZ[i]);
+
+		__m128 outside = _mm_setzero_ps();
+		for (int p = 0; p < 6; p++)
+		{
+			const __m128 sphereDistance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX[p], sx), _mm_mul_ps(normalY[p], sy)),
+				_mm_add_ps(_mm_mul_ps(normalZ[p], sz), distance[p]));
+			// the box reaches this far towards the plane's inside from its center
+			const __m128 boxRadius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absNormalX[p], ex), _mm_mul_ps(absNormalY[p], ey)),
+				_mm_mul_ps(absNormalZ[p], ez));
+			const __m128 boxDistance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX[p], bx), _mm_mul_ps(normalY[p], by)),
+				_mm_add_ps(_mm_mul_ps(normalZ[p], bz), distance[p]));
+			outside = _mm_or_ps(outside, _mm_or_ps(
+				_mm_cmplt_ps(_mm_add_ps(sphereDistance, sr), _mm_setzero_ps()),
+				_mm_cmplt_ps(_mm_add_ps(boxDistance, boxRadius), _mm_setzero_ps())));
+		}
+
+		uint32_t inside = ~static_cast<uint32_t>(_mm_movemask_ps(outside)) & 0xF;
+		if (count - i < 4)
+		{
+			inside &= (1u << (count - i)) - 1;
+		}
+		while (inside != 0)
+		{
+			visible.push_back(i + std::countr_zero(inside));
+			inside &= inside - 1;
+		}
+	}
+#else
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (!isOutside(i, frustum))
+		{
+			visible.push_back(i);
+		}
+	}
+#endif
+
+	// drop the padding so further adds append after the last object
+	for (std::vector<float>* values : arrays())
+	{
+		values->resize(count);
+	}
+
+	stats.tested = count;
+	stats.visible = static_cast<uint32_t>(visible.size());
+}
+
+void FrustumCuller::pad()
+{
+	// whole groups of four can be loaded past the last object; the extra lanes are masked off
+	const size_t padded = (count + 3) & ~size_t{ 3 };
+	for (std::vector<float>* values : arrays())
+	{
+		values->resize(padded, 0.0f);
+	}
+}
+
+std::array<std::vector<float>*, 10> FrustumCuller::arrays()
+{
+	return { &sphereX, &sphereY, &sphereZ, &sphereRadius, &boxX, &boxY, &boxZ, &extentX, &extentY, &extentZ };
+}
+
+bool FrustumCuller::isOutside(size_t i, const Frustum& frustum) const
+{
+	for (const glm::vec4& plane : frustum.planes)
+	{
+		const glm::vec3 normal{ plane };
+		if (glm::dot(normal, glm::vec3{ sphereX[i], sphereY[i], sphereZ[i] }) + plane.w < -sphereRadius[i])
+		{
+			return true;
+		}
+		const float boxRadius = glm::dot(glm::abs(normal), glm::vec3{ extentX[i], extentY[i], extentZ[i] });
+		if (glm::dot(normal, glm::vec3{ boxX[i], boxY[i], boxZ[i] }) + plane.w < -boxRadius)
+		{
+			return true;
+		}
+	}
+	return false;
+}
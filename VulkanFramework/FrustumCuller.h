@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Bounds.h"
+#include "Frustum.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Tests world space bounds against a frustum four objects at a time. The bounds are kept
+// structure of arrays, so every plane is a few SSE multiply adds over four spheres and four boxes.
+// An object is culled when either its sphere or its box lies fully outside one plane.
+class FrustumCuller
+{
+public:
+	struct Stats
+	{
+		uint32_t tested = 0;
+		uint32_t visible = 0;
+	};
+public:
+	FrustumCuller() = default;
+	FrustumCuller(const FrustumCuller&) = delete;
+	FrustumCuller& operator=(const FrustumCuller&) = delete;
+
+	void clear();
+	void reserve(size_t count);
+	// Objects are numbered in the order they were added.
+	void add(const BoundingSphere& sphere, const BoundingBox& box);
+	// Replaces visible with the ascending numbers of the objects inside or crossing the frustum.
+	void cull(const Frustum& frustum, std::vector<uint32_t>& visible);
+
+	uint32_t getCount() const
+	{
+		return count;
+	}
+	const Stats& getStats() const
+	{
+		return stats;
+	}
+private:
+	void pad();
+	std::array<std::vector<float>*, 10> arrays();
+	bool isOutside(size_t i, const Frustum& frustum) const;
+private:
+	std::vector<float> sphereX;
+	std::vector<float> sphereY;
+	std::vector<float> sphereZ;
+	std::vector<float> sphereRadius;
+	std::vector<float> boxX;
+	std::vector<float> boxY;
+	std::vector<float> boxZ;
+	std::vector<float> extentX;
+	std::vector<float> extentY;
+	std::vector<float> extentZ;
+	uint32_t count = 0;
+	Stats stats;
+};
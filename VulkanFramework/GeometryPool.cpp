@@ -0,0 +1,282 @@
+#include "GeometryPool.h"
+
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+GeometryPool::GeometryPool(EngineDevice& device, VkDeviceSize vertexStride, uint32_t vertexCapacity, uint32_t indexCapacity,
+	uint32_t meshletCapacity)
+	:
+	device(device),
+	vertexStride(vertexStride),
+	vertexRanges(vertexCapacity),
+	indexRanges(indexCapacity * sizeof(uint32_t)),
+	meshletRanges(meshletCapacity)
+{
+	createBuffers(vertexCapacity, indexRanges.getSize(), meshletCapacity);
+}
+
+GeometryPool::~GeometryPool()
+{
+	device.destroyBuffer(vertexBuffer, vertexBufferMemory);
+	device.destroyBuffer(indexBuffer, indexBufferMemory);
+	device.destroyBuffer(meshletBuffer, meshletBufferMemory);
+}
+
+GeometryPool::RangeId GeometryPool::allocate(const void* vertexData, uint32_t vertexCount, const void* indexData, uint32_t indexCount,
+	VkIndexType indexType, const Meshlet* meshletData, uint32_t meshletCount)
+{
+	const size_t vertexBytes = static_cast<size_t>(vertexCount * vertexStride);
+	const size_t indexBytes = static_cast<size_t>(indexCount * indexSize(indexType));
+	return allocate(
+		[&](void* destination) { memcpy(destination, vertexData, vertexBytes); }, vertexCount,
+		[&](void* destination) { memcpy(destination, indexData, indexBytes); }, indexCount,
+		indexType, meshletData, meshletCount);
+}
+
+GeometryPool::RangeId GeometryPool::allocate(const Fill& fillVertices, uint32_t vertexCount, const Fill& fillIndices, uint32_t indexCount,
+	VkIndexType indexType, const Meshlet* meshletData, uint32_t meshletCount)
+{
+	assert(vertexCount > 0 && "Cannot allocate an empty geometry range!");
+
+	Range range{};
+	if (!tryAllocate(vertexCount, indexCount, indexType, meshletCount, range))
+	{
+		// Packing the live ranges is enough when the space is merely fragmented, otherwise grow.
+		// Re-packing can add a little alignment padding between 16 and 32-bit ranges, hence the slack.
+		const VkDeviceSize indexBytes = indexCount * indexSize(indexType);
+		uint32_t newVertexCapacity = static_cast<uint32_t>(vertexRanges.getSize());
+		VkDeviceSize newIndexBufferSize = indexRanges.getSize();
+		while (vertexRanges.getUsed() + vertexCount > newVertexCapacity)
+		{
+			newVertexCapacity *= 2;
+		}
+		while (indexRanges.getUsed() + indexBytes + indexRanges.getAllocationCount() * sizeof(uint16_t) + sizeof(uint16_t) > newIndexBufferSize)
+		{
+			newIndexBufferSize *= 2;
+		}
+		uint32_t newMeshletCapacity = static_cast<uint32_t>(meshletRanges.getSize());
+		while (meshletRanges.getUsed() + meshletCount > newMeshletCapacity)
+		{
+			newMeshletCapacity *= 2;
+		}
+
+		relocate(newVertexCapacity, newIndexBufferSize, newMeshletCapacity);
+
+		if (!tryAllocate(vertexCount, indexCount, indexType, meshletCount, range))
+		{
+			throw std::runtime_error("Failed to allocate geometry range after relocation!");
+		}
+	}
+
+	UploadService& uploads = device.uploadService();
+	// each staging region is filled before the next upload, which may submit it
+	fillVertices(uploads.stageBuffer(vertexBuffer, range.firstVertex * vertexStride, vertexCount * vertexStride));
+	if (indexCount > 0)
+	{
+		fillIndices(uploads.stageBuffer(indexBuffer, range.firstIndex * range.indexSize(), indexCount * range.indexSize()));
+	}
+	if (meshletCount > 0)
+	{
+		uploads.uploadBuffer(meshletBuffer, range.firstMeshlet * sizeof(Meshlet), meshletData, meshletCount * sizeof(Meshlet));
+	}
+	range.uploadToken = uploads.pendingToken();
+
+	RangeId id;
+	if (!freeIds.empty())
+	{
+		id = freeIds.back();
+		freeIds.pop_back();
+		ranges[id] = range;
+		liveRanges[id] = true;
+	}
+	else
+	{
+		id = static_cast<RangeId>(ranges.size());
+		ranges.push_back(range);
+		liveRanges.push_back(true);
+	}
+
+	return id;
+}
+
+void GeometryPool::free(RangeId id)
+{
+	assert(liveRanges[id] && "Geometry range freed twice!");
+
+	const Range& range = ranges[id];
+	vertexRanges.free(range.firstVertex, range.vertexCount);
+	if (range.indexCount > 0)
+	{
+		freeIndices(indexRanges, range.firstIndex, range.indexCount, range.indexType);
+	}
+	if (range.meshletCount > 0)
+	{
+		meshletRanges.free(range.firstMeshlet, range.meshletCount);
+	}
+
+	liveRanges[id] = false;
+	freeIds.push_back(id);
+}
+
+void GeometryPool::compact()
+{
+	relocate(static_cast<uint32_t>(vertexRanges.getSize()), indexRanges.getSize(), static_cast<uint32_t>(meshletRanges.getSize()));
+}
+
+void GeometryPool::bind(VkCommandBuffer commandBuffer, VkIndexType indexType)
+{
+	VkBuffer buffers[] = { vertexBuffer };
+	VkDeviceSize offsets[] = { 0 };
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+	vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, indexType);
+}
+
+void GeometryPool::bind(CommandRecorder& recorder, VkIndexType indexType)
+{
+	VkBuffer buffers[] = { vertexBuffer };
+	VkDeviceSize offsets[] = { 0 };
+	recorder.bindVertexBuffers(0, 1, buffers, offsets);
+	recorder.bindIndexBuffer(indexBuffer, 0, indexType);
+}
+
+bool GeometryPool::tryAllocate(uint32_t vertexCount, uint32_t indexCount, VkIndexType indexType, uint32_t meshletCount, Range& range)
+{
+	uint64_t firstVertex = 0;
+	uint32_t firstIndex = 0;
+	uint64_t firstMeshlet = 0;
+
+	if (!vertexRanges.allocate(vertexCount, 1, firstVertex))
+	{
+		return false;
+	}
+	if (indexCount > 0 && !allocateIndices(indexRanges, indexCount, indexType, firstIndex))
+	{
+		vertexRanges.free(firstVertex, vertexCount);
+		return false;
+	}
+	if (meshletCount > 0 && !meshletRanges.allocate(meshletCount, 1, firstMeshlet))
+	{
+		vertexRanges.free(firstVertex, vertexCount);
+		if (indexCount > 0)
+		{
+			freeIndices(indexRanges, firstIndex, indexCount, indexType);
+		}
+		return false;
+	}
+
+	range.firstVertex = static_cast<uint32_t>(firstVertex);
+	range.vertexCount = vertexCount;
+	range.firstIndex = firstIndex;
+	range.indexCount = indexCount;
+	range.indexType = indexType;
+	range.firstMeshlet = static_cast<uint32_t>(firstMeshlet);
+	range.meshletCount = meshletCount;
+	return true;
+}
+
+void GeometryPool::relocate(uint32_t newVertexCapacity, VkDeviceSize newIndexBufferSize, uint32_t newMeshletCapacity)
+{
+	// Frames in flight may still read the old buffers, and uploads may still write them.
+	UploadService& uploads = device.uploadService();
+	uploads.wait(uploads.flush());
+	vkDeviceWaitIdle(device.device());
+
+	VkBuffer oldVertexBuffer = vertexBuffer;
+	MemoryAllocation oldVertexBufferMemory = vertexBufferMemory;
+	VkBuffer oldIndexBuffer = indexBuffer;
+	MemoryAllocation oldIndexBufferMemory = indexBufferMemory;
+	VkBuffer oldMeshletBuffer = meshletBuffer;
+	MemoryAllocation oldMeshletBufferMemory = meshletBufferMemory;
+
+	createBuffers(newVertexCapacity, newIndexBufferSize, newMeshletCapacity);
+	vertexRanges.reset(newVertexCapacity);
+	indexRanges.reset(newIndexBufferSize);
+	meshletRanges.reset(newMeshletCapacity);
+
+	std::vector<VkBufferCopy> vertexCopies;
+	std::vector<VkBufferCopy> indexCopies;
+	std::vector<VkBufferCopy> meshletCopies;
+
+	for (size_t i = 0; i < ranges.size(); i++)
+	{
+		if (!liveRanges[i])
+		{
+			continue;
+		}
+
+		Range& range = ranges[i];
+		const Range oldRange = range;
+		if (!tryAllocate(oldRange.vertexCount, oldRange.indexCount, oldRange.indexType, oldRange.meshletCount, range))
+		{
+			throw std::runtime_error("Failed to re-pack geometry range!");
+		}
+		range.uploadToken = {};
+
+		vertexCopies.push_back({
+			oldRange.firstVertex * vertexStride,
+			range.firstVertex * vertexStride,
+			range.vertexCount * vertexStride });
+		if (range.indexCount > 0)
+		{
+			indexCopies.push_back({
+				oldRange.firstIndex * oldRange.indexSize(),
+				range.firstIndex * range.indexSize(),
+				range.indexCount * range.indexSize() });
+		}
+		if (range.meshletCount > 0)
+		{
+			meshletCopies.push_back({
+				oldRange.firstMeshlet * sizeof(Meshlet),
+				range.firstMeshlet * sizeof(Meshlet),
+				range.meshletCount * sizeof(Meshlet) });
+		}
+	}
+
+	if (!vertexCopies.empty())
+	{
+		VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
+		uploads.acquireOnGraphics(commandBuffer);
+		vkCmdCopyBuffer(commandBuffer, oldVertexBuffer, vertexBuffer,
+			static_cast<uint32_t>(vertexCopies.size()), vertexCopies.data());
+		if (!indexCopies.empty())
+		{
+			vkCmdCopyBuffer(commandBuffer, oldIndexBuffer, indexBuffer,
+				static_cast<uint32_t>(indexCopies.size()), indexCopies.data());
+		}
+		if (!meshletCopies.empty())
+		{
+			vkCmdCopyBuffer(commandBuffer, oldMeshletBuffer, meshletBuffer,
+				static_cast<uint32_t>(meshletCopies.size()), meshletCopies.data());
+		}
+		device.endSingleTimeCommands(commandBuffer);
+	}
+
+	device.destroyBuffer(oldVertexBuffer, oldVertexBufferMemory);
+	device.destroyBuffer(oldIndexBuffer, oldIndexBufferMemory);
+	device.destroyBuffer(oldMeshletBuffer, oldMeshletBufferMemory);
+}
+
+void GeometryPool::createBuffers(uint32_t newVertexCapacity, VkDeviceSize newIndexBufferSize, uint32_t newMeshletCapacity)
+{
+	device.createBuffer(
+		newVertexCapacity * vertexStride,
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		vertexBuffer,
+		vertexBufferMemory);
+
+	device.createBuffer(
+		newIndexBufferSize,
+		VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		indexBuffer,
+		indexBufferMemory);
+
+	device.createBuffer(
+		newMeshletCapacity * sizeof(Meshlet),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		meshletBuffer,
+		meshletBufferMemory);
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "CommandRecorder.h"
+#include "EngineDevice.h"
+#include "Meshlet.h"
+#include "RangeAllocator.h"
+#include "UploadService.h"
+#include <functional>
+#include <vector>
+
+// Packs the vertices and indices of many models into one shared vertex buffer
+// and one shared index buffer, so every model in the pool draws after a single bind.
+// Indices stay local to their model; draws rebase them with vertexOffset.
+// 16 and 32-bit index ranges share the index buffer, which is bound at offset 0
+// with the type of the range being drawn; firstIndex counts in that type.
+// Meshlet tables live in a third, storage buffer, for culling clusters on the GPU.
+class GeometryPool
+{
+public:
+	using RangeId = uint32_t;
+
+	static constexpr uint32_t DEFAULT_VERTEX_CAPACITY = 1 << 18;
+	static constexpr uint32_t DEFAULT_INDEX_CAPACITY = 1 << 20;
+	static constexpr uint32_t DEFAULT_MESHLET_CAPACITY = 1 << 14;
+
+	struct Range
+	{
+		uint32_t firstVertex = 0;
+		uint32_t vertexCount = 0;
+		uint32_t firstIndex = 0;
+		uint32_t indexCount = 0;
+		VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+		uint32_t firstMeshlet = 0;
+		uint32_t meshletCount = 0;
+		// completes once the range's data is on the device
+		UploadToken uploadToken{};
+
+		int32_t vertexOffset() const
+		{
+			return static_cast<int32_t>(firstVertex);
+		}
+		VkDeviceSize indexSize() const
+		{
+			return GeometryPool::indexSize(indexType);
+		}
+	};
+public:
+	// indexCapacity counts 32-bit indices, twice as many 16-bit ones fit
+	GeometryPool(EngineDevice& device, VkDeviceSize vertexStride,
+		uint32_t vertexCapacity = DEFAULT_VERTEX_CAPACITY, uint32_t indexCapacity = DEFAULT_INDEX_CAPACITY,
+		uint32_t meshletCapacity = DEFAULT_MESHLET_CAPACITY);
+	~GeometryPool();
+	GeometryPool(const GeometryPool&) = delete;
+	GeometryPool& operator=(const GeometryPool&) = delete;
+
+	// indexData holds indexCount indices of indexType.
+	RangeId allocate(const void* vertexData, uint32_t vertexCount, const void* indexData, uint32_t indexCount,
+		VkIndexType indexType = VK_INDEX_TYPE_UINT32, const Meshlet* meshletData = nullptr, uint32_t meshletCount = 0);
+	// allocate for data converted on the way in: the fills write the vertices and indices straight to staging memory.
+	using Fill = std::function<void(void* destination)>;
+	RangeId allocate(const Fill& fillVertices, uint32_t vertexCount, const Fill& fillIndices, uint32_t indexCount,
+		VkIndexType indexType = VK_INDEX_TYPE_UINT32, const Meshlet* meshletData = nullptr, uint32_t meshletCount = 0);
+	void free(RangeId id);
+	// Moves all live ranges to the front of the buffers. Waits for the device and pending uploads to go idle.
+	void compact();
+
+	const Range& getRange(RangeId id) const
+	{
+		return ranges[id];
+	}
+	VkDeviceSize getVertexStride() const
+	{
+		return vertexStride;
+	}
+	void bind(VkCommandBuffer commandBuffer, VkIndexType indexType);
+	void bind(CommandRecorder& recorder, VkIndexType indexType);
+	// Changes whenever the pool grows or compacts.
+	VkBuffer getMeshletBuffer() const
+	{
+		return meshletBuffer;
+	}
+
+	static VkDeviceSize indexSize(VkIndexType indexType)
+	{
+		return indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+	}
+	// indexRanges counts bytes; ranges are aligned to the index size so firstIndex is a whole number of indices
+	static bool allocateIndices(RangeAllocator& indexRanges, uint32_t indexCount, VkIndexType indexType, uint32_t& firstIndex)
+	{
+		const VkDeviceSize size = indexSize(indexType);
+		uint64_t offset = 0;
+		if (!indexRanges.allocate(indexCount * size, size, offset))
+		{
+			return false;
+		}
+		firstIndex = static_cast<uint32_t>(offset / size);
+		return true;
+	}
+	static void freeIndices(RangeAllocator& indexRanges, uint32_t firstIndex, uint32_t indexCount, VkIndexType indexType)
+	{
+		const VkDeviceSize size = indexSize(indexType);
+		indexRanges.free(firstIndex * size, indexCount * size);
+	}
+private:
+	bool tryAllocate(uint32_t vertexCount, uint32_t indexCount, VkIndexType indexType, uint32_t meshletCount, Range& range);
+	void relocate(uint32_t newVertexCapacity, VkDeviceSize newIndexBufferSize, uint32_t newMeshletCapacity);
+	void createBuffers(uint32_t newVertexCapacity, VkDeviceSize newIndexBufferSize, uint32_t newMeshletCapacity);
+private:
+	EngineDevice& device;
+	VkDeviceSize vertexStride;
+
+	VkBuffer vertexBuffer;
+	MemoryAllocation vertexBufferMemory;
+	RangeAllocator vertexRanges;
+
+	VkBuffer indexBuffer;
+	MemoryAllocation indexBufferMemory;
+	// in bytes
+	RangeAllocator indexRanges;
+
+	VkBuffer meshletBuffer;
+	MemoryAllocation meshletBufferMemory;
+	RangeAllocator meshletRanges;
+
+	std::vector<Range> ranges;
+	std::vector<bool> liveRanges;
+	std::vector<RangeId> freeIds;
+};
@@ -1,6 +1,6 @@
 #include "KeyboardMovementController.h"
 
-void KeyboardMovementController::moveInPlaneXZ(GLFWwindow* window, float dt, GameObject& gameObject)
+void KeyboardMovementController::moveInPlaneXZ(GLFWwindow* window, float dt, TransformComponent& transform)
 {
 	glm::vec3 rotate{ 0.0f };
 	if (glfwGetKey(window, keys.lookRight) == GLFW_PRESS) rotate.y += 1.0f;
@@ -8,15 +8,20 @@ void KeyboardMovementController::moveInPlaneXZ(GLFWwindow* window, float dt, Gam
 	if (glfwGetKey(window, keys.lookUp) == GLFW_PRESS) rotate.x += 1.0f;
 	if (glfwGetKey(window, keys.lookDown) == GLFW_PRESS) rotate.x -= 1.0f;
 
+	glm::vec3 rotation = transform.getRotation();
 	if (glm::dot(rotate, rotate) > std::numeric_limits<float>::epsilon())
 	{
-		gameObject.transform.rotation += lookSpeed * dt * glm::normalize(rotate);
+		rotation += lookSpeed * dt * glm::normalize(rotate);
 	}
 
-	gameObject.transform.rotation.x = glm::clamp(gameObject.transform.rotation.x, -1.5f, 1.5f);
-	gameObject.transform.rotation.y = glm::mod(gameObject.transform.rotation.y, glm::two_pi<float>());
+	rotation.x = glm::clamp(rotation.x, -1.5f, 1.5f);
+	rotation.y = glm::mod(rotation.y, glm::two_pi<float>());
+	if (rotation != transform.getRotation())
+	{
+		transform.setRotation(rotation);
+	}
 
-	float yaw = gameObject.transform.rotation.y;
+	float yaw = rotation.y;
 	glm::vec3 forwardDir{ sin(yaw), 0.0f, cos(yaw) };
 	glm::vec3 rightDir{ forwardDir.z, 0.0f, -forwardDir.x };
 	glm::vec3 upDir{  0.0f, -1.0f, 0.0f };
@@ -31,6 +36,6 @@ void KeyboardMovementController::moveInPlaneXZ(GLFWwindow* window, float dt, Gam
 
 	if (glm::dot(moveDir, moveDir) > std::numeric_limits<float>::epsilon())
 	{
-		gameObject.transform.translation += moveSpeed * dt * glm::normalize(moveDir);
+		transform.setTranslation(transform.getTranslation() + moveSpeed * dt * glm::normalize(moveDir));
 	}
 }
@@ -1,7 +1,9 @@
 #pragma once
 
-#include "GameObject.h"
+#include "TransformComponent.h"
 #include "Window.h"
+#include <glm/gtc/constants.hpp>
+#include <limits>
 
 class KeyboardMovementController
 {
@@ -19,7 +21,7 @@ public:
         int lookDown = GLFW_KEY_DOWN;
     };
 
-    void moveInPlaneXZ(GLFWwindow* window, float dt, GameObject& gameObject);
+    void moveInPlaneXZ(GLFWwindow* window, float dt, TransformComponent& transform);
 
     KeyMappings keys{};
     float moveSpeed{ 3.0f };
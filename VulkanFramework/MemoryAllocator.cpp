@@ -0,0 +1,234 @@
+#include "MemoryAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iomanip>
+#include <stdexcept>
+
+MemoryAllocator::MemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device)
+	:
+	device(device)
+{
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+}
+
+MemoryAllocator::~MemoryAllocator()
+{
+	for (auto& pool : pools)
+	{
+		for (auto& block : pool)
+		{
+			assert(block->isEmpty() && "Memory block destroyed with live allocations!");
+			freeDeviceMemory(block->getMemory(), block->getMappedData());
+		}
+	}
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+	{
+		assert(dedicatedAllocations[i].empty() && "Dedicated allocation leaked!");
+	}
+}
+
+MemoryAllocation MemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, ResourceKind kind)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	MemoryAllocation allocation{};
+	allocation.memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties);
+	allocation.size = requirements.size;
+
+	const VkDeviceSize blockSize = preferredBlockSize(allocation.memoryTypeIndex);
+
+	// Large resources get their own memory so they don't strand half a block.
+	if (requirements.size > blockSize / 2)
+	{
+		allocation.memory = allocateDeviceMemory(requirements.size, allocation.memoryTypeIndex, &allocation.mappedData);
+		dedicatedAllocations[allocation.memoryTypeIndex].emplace(allocation.memory, requirements.size);
+		return allocation;
+	}
+
+	auto& pool = pools[allocation.memoryTypeIndex * static_cast<size_t>(ResourceKind::Count) + static_cast<size_t>(kind)];
+
+	MemoryBlock* target = nullptr;
+	for (auto& block : pool)
+	{
+		if (block->allocate(requirements.size, requirements.alignment, allocation.offset))
+		{
+			target = block.get();
+			break;
+		}
+	}
+
+	if (target == nullptr)
+	{
+		void* mappedData = nullptr;
+		VkDeviceMemory memory = allocateDeviceMemory(blockSize, allocation.memoryTypeIndex, &mappedData);
+		pool.push_back(std::make_unique<MemoryBlock>(memory, blockSize, allocation.memoryTypeIndex, mappedData));
+		target = pool.back().get();
+
+		if (!target->allocate(requirements.size, requirements.alignment, allocation.offset))
+		{
+			throw std::runtime_error("Failed to sub-allocate from a fresh memory block!");
+		}
+	}
+
+	allocation.memory = target->getMemory();
+	allocation.block = target;
+	if (target->getMappedData() != nullptr)
+	{
+		allocation.mappedData = static_cast<char*>(target->getMappedData()) + allocation.offset;
+	}
+
+	return allocation;
+}
+
+void MemoryAllocator::free(MemoryAllocation& allocation)
+{
+	if (allocation.memory == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (allocation.block == nullptr)
+	{
+		dedicatedAllocations[allocation.memoryTypeIndex].erase(allocation.memory);
+		freeDeviceMemory(allocation.memory, allocation.mappedData);
+	}
+	else
+	{
+		MemoryBlock* block = allocation.block;
+		block->free(allocation.offset, allocation.size);
+
+		// Keep one empty block around per pool so alternating load/unload doesn't thrash vkAllocateMemory.
+		if (block->isEmpty())
+		{
+			for (auto& pool : pools)
+			{
+				auto it = std::find_if(pool.begin(), pool.end(), [block](const auto& b) { return b.get() == block; });
+				if (it == pool.end())
+				{
+					continue;
+				}
+				const auto emptyBlocks = std::count_if(pool.begin(), pool.end(), [](const auto& b) { return b->isEmpty(); });
+				if (emptyBlocks > 1)
+				{
+					freeDeviceMemory(block->getMemory(), block->getMappedData());
+					pool.erase(it);
+				}
+				break;
+			}
+		}
+	}
+
+	allocation = MemoryAllocation{};
+}
+
+std::vector<MemoryAllocator::HeapStats> MemoryAllocator::getHeapStats() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::vector<HeapStats> stats(memoryProperties.memoryHeapCount);
+
+	for (const auto& pool : pools)
+	{
+		for (const auto& block : pool)
+		{
+			HeapStats& heap = stats[memoryProperties.memoryTypes[block->getMemoryTypeIndex()].heapIndex];
+			heap.blockCount++;
+			heap.allocationCount += block->getAllocationCount();
+			heap.bytesReserved += block->getSize();
+			heap.bytesUsed += block->getUsed();
+			heap.bytesFree += block->getSize() - block->getUsed();
+			heap.largestFreeRange = std::max(heap.largestFreeRange, block->largestFreeRange());
+		}
+	}
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+	{
+		HeapStats& heap = stats[memoryProperties.memoryTypes[i].heapIndex];
+		for (const auto& [memory, size] : dedicatedAllocations[i])
+		{
+			heap.dedicatedCount++;
+			heap.allocationCount++;
+			heap.bytesReserved += size;
+			heap.bytesUsed += size;
+		}
+	}
+
+	return stats;
+}
+
+void MemoryAllocator::printStats(std::ostream& os) const
+{
+	const auto stats = getHeapStats();
+	for (size_t i = 0; i < stats.size(); i++)
+	{
+		const HeapStats& heap = stats[i];
+		if (heap.bytesReserved == 0)
+		{
+			continue;
+		}
+		os << "memory heap " << i << ": "
+			<< heap.allocationCount << " allocations in "
+			<< heap.blockCount + heap.dedicatedCount << " device memory objects ("
+			<< heap.blockCount << " blocks, " << heap.dedicatedCount << " dedicated), "
+			<< heap.bytesUsed << " / " << heap.bytesReserved << " bytes used, fragmentation "
+			<< std::fixed << std::setprecision(2) << heap.fragmentation() << std::endl;
+	}
+}
+
+uint32_t MemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+{
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+	{
+		if ((typeFilter & (1 << i)) &&
+			(memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+		{
+			return i;
+		}
+	}
+
+	throw std::runtime_error("Failed to find suitable memory type!");
+}
+
+VkDeviceSize MemoryAllocator::preferredBlockSize(uint32_t memoryTypeIndex) const
+{
+	// Small heaps (e.g. the 256MB BAR heap) would be exhausted by a handful of default sized blocks.
+	const VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[memoryTypeIndex].heapIndex].size;
+	return std::min(DEFAULT_BLOCK_SIZE, heapSize / 8);
+}
+
+VkDeviceMemory MemoryAllocator::allocateDeviceMemory(VkDeviceSize size, uint32_t memoryTypeIndex, void** mappedData)
+{
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+	VkDeviceMemory memory;
+	if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to allocate device memory!");
+	}
+
+	*mappedData = nullptr;
+	if (memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		if (vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, mappedData) != VK_SUCCESS)
+		{
+			vkFreeMemory(device, memory, nullptr);
+			throw std::runtime_error("Failed to map device memory!");
+		}
+	}
+
+	return memory;
+}
+
+void MemoryAllocator::freeDeviceMemory(VkDeviceMemory memory, void* mappedData)
+{
+	if (mappedData != nullptr)
+	{
+		vkUnmapMemory(device, memory);
+	}
+	vkFreeMemory(device, memory, nullptr);
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "RangeAllocator.h"
+#include <vulkan/vulkan.h>
+#include <array>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+class MemoryBlock;
+
+// Handle to a sub-allocated range of device memory. Resources are bound at
+// (memory, offset); mappedData is non-null for host visible memory types,
+// which stay persistently mapped for the lifetime of their block.
+struct MemoryAllocation
+{
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	void* mappedData = nullptr;
+	uint32_t memoryTypeIndex = 0;
+	MemoryBlock* block = nullptr;
+};
+
+class MemoryAllocator
+{
+public:
+	static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+	// Buffers and linear images never share a block with optimal tiling images,
+	// so bufferImageGranularity never has to be honoured between neighbours.
+	enum class ResourceKind
+	{
+		Linear,
+		Optimal,
+		Count
+	};
+
+	struct HeapStats
+	{
+		uint32_t blockCount = 0;
+		uint32_t dedicatedCount = 0;
+		uint32_t allocationCount = 0;
+		VkDeviceSize bytesReserved = 0;
+		VkDeviceSize bytesUsed = 0;
+		VkDeviceSize bytesFree = 0;
+		VkDeviceSize largestFreeRange = 0;
+
+		// 0 when all free space is one contiguous range, approaching 1 as it splinters
+		float fragmentation() const
+		{
+			return bytesFree == 0 ? 0.0f : 1.0f - static_cast<float>(largestFreeRange) / static_cast<float>(bytesFree);
+		}
+	};
+public:
+	MemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device);
+	~MemoryAllocator();
+	MemoryAllocator(const MemoryAllocator&) = delete;
+	MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+
+	MemoryAllocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, ResourceKind kind);
+	void free(MemoryAllocation& allocation);
+
+	std::vector<HeapStats> getHeapStats() const;
+	void printStats(std::ostream& os) const;
+private:
+	uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+	VkDeviceSize preferredBlockSize(uint32_t memoryTypeIndex) const;
+	VkDeviceMemory allocateDeviceMemory(VkDeviceSize size, uint32_t memoryTypeIndex, void** mappedData);
+	void freeDeviceMemory(VkDeviceMemory memory, void* mappedData);
+private:
+	VkDevice device;
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	std::array<std::vector<std::unique_ptr<MemoryBlock>>, VK_MAX_MEMORY_TYPES * static_cast<size_t>(ResourceKind::Count)> pools;
+	std::array<std::map<VkDeviceMemory, VkDeviceSize>, VK_MAX_MEMORY_TYPES> dedicatedAllocations;
+	mutable std::mutex mutex;
+};
+
+// A single VkDeviceMemory page carved into ranges by a RangeAllocator.
+class MemoryBlock
+{
+public:
+	MemoryBlock(VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryTypeIndex, void* mappedData)
+		:
+		memory(memory),
+		memoryTypeIndex(memoryTypeIndex),
+		mappedData(mappedData),
+		ranges(size)
+	{}
+
+	bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset)
+	{
+		return ranges.allocate(size, alignment, offset);
+	}
+	void free(VkDeviceSize offset, VkDeviceSize size)
+	{
+		ranges.free(offset, size);
+	}
+	bool isEmpty() const
+	{
+		return ranges.isEmpty();
+	}
+	VkDeviceMemory getMemory() const
+	{
+		return memory;
+	}
+	VkDeviceSize getSize() const
+	{
+		return ranges.getSize();
+	}
+	VkDeviceSize getUsed() const
+	{
+		return ranges.getUsed();
+	}
+	uint32_t getAllocationCount() const
+	{
+		return ranges.getAllocationCount();
+	}
+	uint32_t getMemoryTypeIndex() const
+	{
+		return memoryTypeIndex;
+	}
+	void* getMappedData() const
+	{
+		return mappedData;
+	}
+	VkDeviceSize largestFreeRange() const
+	{
+		return ranges.largestFreeRange();
+	}
+private:
+	VkDeviceMemory memory;
+	uint32_t memoryTypeIndex;
+	void* mappedData;
+	RangeAllocator ranges;
+};
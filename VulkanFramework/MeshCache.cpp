@@ -0,0 +1,243 @@
+#include "MeshCache.h"
+#include "Utils.h"
+
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace
+{
+	constexpr char MAGIC[4] = { 'V', 'F', 'M', 'C' };
+
+	struct SourceInfo
+	{
+		uint64_t size = 0;
+		int64_t writeTime = 0;
+	};
+
+	bool getSourceInfo(const std::string& sourcePath, SourceInfo& info)
+	{
+		std::error_code error;
+		info.size = std::filesystem::file_size(sourcePath, error);
+		if (error)
+		{
+			return false;
+		}
+		info.writeTime = std::filesystem::last_write_time(sourcePath, error).time_since_epoch().count();
+		return !error;
+	}
+
+	bool hashSource(const std::string& sourcePath, uint64_t& hash)
+	{
+		MappedFile source{ sourcePath };
+		if (!source.isOpen())
+		{
+			return false;
+		}
+		hash = hashBytes(source.getData(), source.getSize());
+		return true;
+	}
+
+	// Vertices, indices, LODs and meshlets, in file order.
+	uint64_t hashPayload(const void* const (&blobs)[4], const size_t (&sizes)[4])
+	{
+		uint64_t hash = 0;
+		for (size_t i = 0; i < 4; i++)
+		{
+			hash = hashBytes(blobs[i], sizes[i], hash);
+		}
+		return hash;
+	}
+}
+
+MeshCache::MeshCache(const std::string& sourcePath, uint32_t flags)
+	:
+	file(cachePathFor(sourcePath))
+{
+	int64_t sourceWriteTime = 0;
+	if (!validate(sourcePath, flags, sourceWriteTime))
+	{
+		// the mapping would keep write from replacing the file
+		file = MappedFile{};
+		return;
+	}
+
+	// A touched but unchanged source gets its new time stored, so later loads don't hash it again.
+	// The header is patched with the file unmapped, then the cache is mapped and checked anew.
+	if (reinterpret_cast<const Header*>(file.getData())->sourceWriteTime != sourceWriteTime)
+	{
+		const std::string cachePath = cachePathFor(sourcePath);
+		file = MappedFile{};
+		{
+			std::fstream out{ cachePath, std::ios::binary | std::ios::in | std::ios::out };
+			out.seekp(offsetof(Header, sourceWriteTime));
+			out.write(reinterpret_cast<const char*>(&sourceWriteTime), sizeof(sourceWriteTime));
+		}
+		file = MappedFile{ cachePath };
+		if (!validate(sourcePath, flags, sourceWriteTime))
+		{
+			file = MappedFile{};
+			return;
+		}
+	}
+
+	header = reinterpret_cast<const Header*>(file.getData());
+}
+
+bool MeshCache::validate(const std::string& sourcePath, uint32_t flags, int64_t& sourceWriteTime) const
+{
+	if (!file.isOpen() || file.getSize() < PAYLOAD_OFFSET)
+	{
+		return false;
+	}
+
+	const Header* candidate = reinterpret_cast<const Header*>(file.getData());
+	if (memcmp(candidate->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+		candidate->version != VERSION ||
+		candidate->vertexStride != sizeof(Model::Vertex) ||
+		candidate->flags != flags)
+	{
+		return false;
+	}
+
+	const uint64_t payloadSize =
+		uint64_t(candidate->vertexCount) * sizeof(Model::Vertex) + uint64_t(candidate->indexCount) * sizeof(uint32_t) +
+		uint64_t(candidate->lodCount) * sizeof(Model::Lod) + uint64_t(candidate->meshletCount) * sizeof(Meshlet);
+	if (file.getSize() != PAYLOAD_OFFSET + payloadSize)
+	{
+		return false;
+	}
+
+	SourceInfo source;
+	if (!getSourceInfo(sourcePath, source) || source.size != candidate->sourceSize)
+	{
+		return false;
+	}
+	// A touched but unchanged source (checkout, copy) keeps its cache.
+	if (source.writeTime != candidate->sourceWriteTime)
+	{
+		uint64_t sourceHash;
+		if (!hashSource(sourcePath, sourceHash) || sourceHash != candidate->sourceHash)
+		{
+			return false;
+		}
+	}
+
+	const char* vertexBlob = file.getData() + PAYLOAD_OFFSET;
+	const size_t vertexBytes = size_t(candidate->vertexCount) * sizeof(Model::Vertex);
+	const size_t indexBytes = size_t(candidate->indexCount) * sizeof(uint32_t);
+	const size_t lodBytes = size_t(candidate->lodCount) * sizeof(Model::Lod);
+	const size_t meshletBytes = size_t(candidate->meshletCount) * sizeof(Meshlet);
+	const char* indexBlob = vertexBlob + vertexBytes;
+	const char* lodBlob = indexBlob + indexBytes;
+	if (hashPayload({ vertexBlob, indexBlob, lodBlob, lodBlob + lodBytes }, { vertexBytes, indexBytes, lodBytes, meshletBytes }) !=
+		candidate->payloadChecksum)
+	{
+		return false;
+	}
+
+	sourceWriteTime = source.writeTime;
+	return true;
+}
+
+bool MeshCache::write(const std::string& sourcePath, const Model::Builder& builder, uint32_t flags)
+{
+	SourceInfo source;
+	Header header{};
+	if (!getSourceInfo(sourcePath, source) || !hashSource(sourcePath, header.sourceHash))
+	{
+		return false;
+	}
+
+	const size_t vertexBytes = builder.vertices.size() * sizeof(Model::Vertex);
+	const size_t indexBytes = builder.indices.size() * sizeof(uint32_t);
+	const size_t lodBytes = builder.lods.size() * sizeof(Model::Lod);
+	const size_t meshletBytes = builder.meshlets.size() * sizeof(Meshlet);
+
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.vertexStride = sizeof(Model::Vertex);
+	header.flags = flags;
+	header.vertexCount = static_cast<uint32_t>(builder.vertices.size());
+	header.indexCount = static_cast<uint32_t>(builder.indices.size());
+	header.lodCount = static_cast<uint32_t>(builder.lods.size());
+	header.meshletCount = static_cast<uint32_t>(builder.meshlets.size());
+	header.sourceSize = source.size;
+	header.sourceWriteTime = source.writeTime;
+
+	header.boundsMin = builder.bounds.box.min;
+	header.boundsMax = builder.bounds.box.max;
+	header.sphereCenter = builder.bounds.sphere.center;
+	header.sphereRadius = builder.bounds.sphere.radius;
+
+	header.payloadChecksum = hashPayload(
+		{ builder.vertices.data(), builder.indices.data(), builder.lods.data(), builder.meshlets.data() },
+		{ vertexBytes, indexBytes, lodBytes, meshletBytes });
+
+	// Write to a temporary and rename, so a crash never leaves a half written cache behind.
+	const std::string cachePath = cachePathFor(sourcePath);
+	const std::string tempPath = cachePath + ".tmp";
+	{
+		std::ofstream out{ tempPath, std::ios::binary | std::ios::trunc };
+		if (!out.is_open())
+		{
+			return false;
+		}
+
+		char headerBytes[PAYLOAD_OFFSET]{};
+		memcpy(headerBytes, &header, sizeof(Header));
+		out.write(headerBytes, PAYLOAD_OFFSET);
+		out.write(reinterpret_cast<const char*>(builder.vertices.data()), static_cast<std::streamsize>(vertexBytes));
+		out.write(reinterpret_cast<const char*>(builder.indices.data()), static_cast<std::streamsize>(indexBytes));
+		out.write(reinterpret_cast<const char*>(builder.lods.data()), static_cast<std::streamsize>(lodBytes));
+		out.write(reinterpret_cast<const char*>(builder.meshlets.data()), static_cast<std::streamsize>(meshletBytes));
+		if (!out)
+		{
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, cachePath, error);
+	if (error)
+	{
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+	return true;
+}
+
+std::string MeshCache::cachePathFor(const std::string& sourcePath)
+{
+	return sourcePath + ".vfmesh";
+}
+
+uint32_t MeshCache::flagsFor(const Model::LoadOptions& options)
+{
+	return (options.optimize ? FLAG_OPTIMIZED : 0) | (options.generateLods ? FLAG_LODS : 0) |
+		(options.buildMeshlets ? FLAG_MESHLETS : 0);
+}
+
+std::span<const Model::Vertex> MeshCache::getVertices() const
+{
+	return { reinterpret_cast<const Model::Vertex*>(file.getData() + PAYLOAD_OFFSET), header->vertexCount };
+}
+
+std::span<const uint32_t> MeshCache::getIndices() const
+{
+	const size_t vertexBytes = size_t(header->vertexCount) * sizeof(Model::Vertex);
+	return { reinterpret_cast<const uint32_t*>(file.getData() + PAYLOAD_OFFSET + vertexBytes), header->indexCount };
+}
+
+std::span<const Model::Lod> MeshCache::getLods() const
+{
+	const size_t indexEnd = PAYLOAD_OFFSET + size_t(header->vertexCount) * sizeof(Model::Vertex) + size_t(header->indexCount) * sizeof(uint32_t);
+	return { reinterpret_cast<const Model::Lod*>(file.getData() + indexEnd), header->lodCount };
+}
+
+std::span<const Meshlet> MeshCache::getMeshlets() const
+{
+	const std::span<const Model::Lod> lods = getLods();
+	return { reinterpret_cast<const Meshlet*>(lods.data() + lods.size()), header->meshletCount };
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "Model.h"
+#include <span>
+#include <string>
+
+// Binary copy of a parsed model, stored next to its source file as <source>.vfmesh.
+// Layout: Header, vertex blob, index blob, LOD table, meshlet table. The payload is checksummed and the header
+// records the source file's size, modification time and content hash, so edits to
+// the source invalidate the cache. Opening maps the file; the spans point into the mapping.
+class MeshCache
+{
+public:
+	static constexpr uint32_t VERSION = 4;
+	// Load options that change the cached data; a cache only serves loads with matching flags.
+	static constexpr uint32_t FLAG_OPTIMIZED = 1 << 0;
+	static constexpr uint32_t FLAG_LODS = 1 << 1;
+	static constexpr uint32_t FLAG_MESHLETS = 1 << 2;
+
+	struct Header
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t vertexStride;
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		uint32_t flags;
+		uint32_t lodCount;
+		uint32_t meshletCount;
+		uint64_t sourceSize;
+		int64_t sourceWriteTime;
+		uint64_t sourceHash;
+		uint64_t payloadChecksum;
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+		glm::vec3 sphereCenter;
+		float sphereRadius;
+	};
+public:
+	// Maps and validates the cache of sourcePath; isValid() is false when it is missing, stale, corrupt
+	// or was written with different flags.
+	MeshCache(const std::string& sourcePath, uint32_t flags);
+	MeshCache(const MeshCache&) = delete;
+	MeshCache& operator=(const MeshCache&) = delete;
+
+	// Writes the cache for builder's data. Failing to write is not an error, the model just stays uncached.
+	static bool write(const std::string& sourcePath, const Model::Builder& builder, uint32_t flags);
+	static std::string cachePathFor(const std::string& sourcePath);
+	static uint32_t flagsFor(const Model::LoadOptions& options);
+
+	bool isValid() const
+	{
+		return header != nullptr;
+	}
+	std::span<const Model::Vertex> getVertices() const;
+	std::span<const uint32_t> getIndices() const;
+	// empty when the model was cached without LODs
+	std::span<const Model::Lod> getLods() const;
+	// empty when the model was cached without meshlets
+	std::span<const Meshlet> getMeshlets() const;
+	ModelBounds getBounds() const
+	{
+		return { { header->boundsMin, header->boundsMax }, { header->sphereCenter, header->sphereRadius } };
+	}
+	// Views into the mapping, valid while the cache is alive.
+	Model::MeshData getMeshData() const
+	{
+		return { getVertices(), getIndices(), getLods(), getMeshlets(), getBounds() };
+	}
+private:
+	static constexpr size_t PAYLOAD_OFFSET = (sizeof(Header) + 15) & ~size_t(15);
+private:
+	// Whether the mapped file is a cache of sourcePath's current contents; sourceWriteTime gets the source's time.
+	bool validate(const std::string& sourcePath, uint32_t flags, int64_t& sourceWriteTime) const;
+private:
+	MappedFile file;
+	const Header* header = nullptr;
+};
@@ -0,0 +1,318 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace
+{
+	// Triangles around every vertex, in compressed row form.
+	struct Adjacency
+	{
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> triangles;
+
+		Adjacency(std::span<const uint32_t> indices, size_t vertexCount)
+			:
+			offsets(vertexCount + 1, 0),
+			triangles(indices.size())
+		{
+			for (uint32_t index : indices)
+			{
+				offsets[index + 1]++;
+			}
+			std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+			std::vector<uint32_t> cursors(offsets.begin(), offsets.end() - 1);
+			for (size_t i = 0; i < indices.size(); i++)
+			{
+				triangles[cursors[indices[i]]++] = static_cast<uint32_t>(i / 3);
+			}
+		}
+	};
+
+	// FIFO cache keyed by timestamps: a vertex is cached when it was pushed
+	// fewer than cacheSize misses ago.
+	class FifoCache
+	{
+	public:
+		FifoCache(size_t vertexCount, uint32_t cacheSize)
+			:
+			timestamps(vertexCount, 0),
+			cacheSize(cacheSize),
+			time(cacheSize + 1)
+		{
+		}
+
+		// Returns whether vertex missed.
+		bool access(uint32_t vertex)
+		{
+			if (time - timestamps[vertex] > cacheSize)
+			{
+				timestamps[vertex] = time++;
+				return true;
+			}
+			return false;
+		}
+		void flush()
+		{
+			time += cacheSize + 1;
+		}
+	private:
+		std::vector<uint32_t> timestamps;
+		uint32_t cacheSize;
+		uint32_t time;
+	};
+}
+
+MeshOptimizer::CacheStats MeshOptimizer::analyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount, uint32_t cacheSize)
+{
+	CacheStats stats{};
+	if (indices.empty() || vertexCount == 0)
+	{
+		return stats;
+	}
+
+	FifoCache cache{ vertexCount, cacheSize };
+	size_t misses = 0;
+	for (uint32_t index : indices)
+	{
+		misses += cache.access(index);
+	}
+
+	stats.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+	stats.atvr = static_cast<float>(misses) / static_cast<float>(vertexCount);
+	return stats;
+}
+
+void MeshOptimizer::optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount,
+	std::vector<uint32_t>* clusterStarts, uint32_t cacheSize)
+{
+	if (clusterStarts)
+	{
+		clusterStarts->clear();
+	}
+	if (indices.empty())
+	{
+		return;
+	}
+
+	const Adjacency adjacency{ indices, vertexCount };
+	const size_t triangleCount = indices.size() / 3;
+
+	std::vector<uint32_t> liveTriangles(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+	}
+	std::vector<uint32_t> cacheTimes(vertexCount, 0);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint32_t> deadEnds;
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+
+	uint32_t time = cacheSize + 1;
+	size_t scanCursor = 0;
+	int64_t current = 0;
+	bool coldStart = true;
+
+	while (current >= 0)
+	{
+		if (coldStart && clusterStarts)
+		{
+			clusterStarts->push_back(static_cast<uint32_t>(result.size() / 3));
+		}
+
+		// emit every remaining triangle around the fanning vertex
+		candidates.clear();
+		const uint32_t vertex = static_cast<uint32_t>(current);
+		for (uint32_t i = adjacency.offsets[vertex]; i < adjacency.offsets[vertex + 1]; i++)
+		{
+			const uint32_t triangle = adjacency.triangles[i];
+			if (emitted[triangle])
+			{
+				continue;
+			}
+			emitted[triangle] = true;
+
+			for (size_t k = 0; k < 3; k++)
+			{
+				const uint32_t corner = indices[triangle * 3 + k];
+				result.push_back(corner);
+				deadEnds.push_back(corner);
+				candidates.push_back(corner);
+				liveTriangles[corner]--;
+				if (time - cacheTimes[corner] > cacheSize)
+				{
+					cacheTimes[corner] = time++;
+				}
+			}
+		}
+
+		// next fanning vertex: the oldest candidate that stays cached while its triangles are emitted
+		current = -1;
+		int64_t bestPriority = -1;
+		for (uint32_t candidate : candidates)
+		{
+			if (liveTriangles[candidate] == 0)
+			{
+				continue;
+			}
+			int64_t priority = 0;
+			if (time - cacheTimes[candidate] + 2 * liveTriangles[candidate] <= cacheSize)
+			{
+				priority = time - cacheTimes[candidate];
+			}
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				current = candidate;
+			}
+		}
+		coldStart = false;
+
+		if (current < 0)
+		{
+			while (!deadEnds.empty() && current < 0)
+			{
+				const uint32_t deadEnd = deadEnds.back();
+				deadEnds.pop_back();
+				if (liveTriangles[deadEnd] > 0)
+				{
+					current = deadEnd;
+				}
+			}
+			while (current < 0 && scanCursor < vertexCount)
+			{
+				if (liveTriangles[scanCursor] > 0)
+				{
+					current = static_cast<int64_t>(scanCursor);
+					coldStart = true;
+				}
+				scanCursor++;
+			}
+		}
+	}
+
+	indices = std::move(result);
+}
+
+void MeshOptimizer::optimizeOverdraw(std::vector<uint32_t>& indices, std::span<const Model::Vertex> vertices,
+	const std::vector<uint32_t>& clusterStarts, float threshold, uint32_t cacheSize)
+{
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	const float meshAcmr = analyzeVertexCache(indices, vertices.size(), cacheSize).acmr;
+
+	// Soft boundaries: inside each cluster, cut wherever the run so far already beats the threshold.
+	std::vector<uint32_t> clusters;
+	FifoCache cache{ vertices.size(), cacheSize };
+	const uint32_t hardEnd = static_cast<uint32_t>(triangleCount);
+	for (size_t c = 0; c < clusterStarts.size(); c++)
+	{
+		const uint32_t start = clusterStarts[c];
+		const uint32_t end = c + 1 < clusterStarts.size() ? clusterStarts[c + 1] : hardEnd;
+
+		clusters.push_back(start);
+		cache.flush();
+		uint32_t runStart = start;
+		size_t misses = 0;
+		for (uint32_t triangle = start; triangle < end; triangle++)
+		{
+			for (size_t k = 0; k < 3; k++)
+			{
+				misses += cache.access(indices[triangle * 3 + k]);
+			}
+
+			const float runAcmr = static_cast<float>(misses) / static_cast<float>(triangle - runStart + 1);
+			if (triangle + 1 < end && runAcmr <= threshold * meshAcmr)
+			{
+				clusters.push_back(triangle + 1);
+				runStart = triangle + 1;
+				misses = 0;
+				cache.flush();
+			}
+		}
+	}
+	if (clusters.empty() || clusters.front() != 0)
+	{
+		clusters.insert(clusters.begin(), 0);
+	}
+
+	// Sort key from Sander et al.: clusters far out along their own normal are likely to occlude the rest.
+	glm::vec3 meshCenter{ 0.0f };
+	float meshArea = 0.0f;
+	std::vector<glm::vec3> clusterCenters(clusters.size(), glm::vec3{ 0.0f });
+	std::vector<glm::vec3> clusterNormals(clusters.size(), glm::vec3{ 0.0f });
+	std::vector<float> clusterAreas(clusters.size(), 0.0f);
+
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		const uint32_t end = c + 1 < clusters.size() ? clusters[c + 1] : hardEnd;
+		for (uint32_t triangle = clusters[c]; triangle < end; triangle++)
+		{
+			const glm::vec3& p0 = vertices[indices[triangle * 3 + 0]].position;
+			const glm::vec3& p1 = vertices[indices[triangle * 3 + 1]].position;
+			const glm::vec3& p2 = vertices[indices[triangle * 3 + 2]].position;
+			const glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			const float area = glm::length(normal);
+			const glm::vec3 center = (p0 + p1 + p2) / 3.0f;
+
+			clusterCenters[c] += center * area;
+			clusterNormals[c] += normal;
+			clusterAreas[c] += area;
+			meshCenter += center * area;
+			meshArea += area;
+		}
+	}
+	if (meshArea > 0.0f)
+	{
+		meshCenter /= meshArea;
+	}
+
+	std::vector<float> sortKeys(clusters.size());
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		const glm::vec3 center = clusterAreas[c] > 0.0f ? clusterCenters[c] / clusterAreas[c] : meshCenter;
+		const float normalLength = glm::length(clusterNormals[c]);
+		const glm::vec3 normal = normalLength > 0.0f ? clusterNormals[c] / normalLength : glm::vec3{ 0.0f };
+		sortKeys[c] = glm::dot(center - meshCenter, normal);
+	}
+
+	std::vector<uint32_t> order(clusters.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	for (uint32_t c : order)
+	{
+		const uint32_t end = c + 1 < clusters.size() ? clusters[c + 1] : hardEnd;
+		result.insert(result.end(), indices.begin() + clusters[c] * 3, indices.begin() + end * 3);
+	}
+	indices = std::move(result);
+}
+
+void MeshOptimizer::optimizeVertexFetch(std::vector<Model::Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	constexpr uint32_t unused = UINT32_MAX;
+	std::vector<uint32_t> remap(vertices.size(), unused);
+	std::vector<Model::Vertex> result;
+	result.reserve(vertices.size());
+
+	for (uint32_t& index : indices)
+	{
+		if (remap[index] == unused)
+		{
+			remap[index] = static_cast<uint32_t>(result.size());
+			result.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	vertices = std::move(result);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Model.h"
+#include <span>
+#include <vector>
+
+// Reordering passes for indexed triangle lists. None of them change what is drawn,
+// only the order triangles and vertices reach the GPU in.
+namespace MeshOptimizer
+{
+	constexpr uint32_t DEFAULT_CACHE_SIZE = 16;
+
+	struct CacheStats
+	{
+		// transformed vertices per triangle, 0.5 is ideal for large regular meshes
+		float acmr = 0.0f;
+		// transformed vertices per vertex, 1.0 is ideal
+		float atvr = 0.0f;
+	};
+
+	// Simulates a FIFO post transform cache of cacheSize entries.
+	CacheStats analyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount,
+		uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+
+	// Tipsify (Sander et al. 2007). When clusterStarts is given it receives the first triangle
+	// of every run that starts with a cold cache, for optimizeOverdraw.
+	void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount,
+		std::vector<uint32_t>* clusterStarts = nullptr, uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+
+	// Splits the clusters further wherever that keeps the ACMR within threshold of the
+	// input's, then sorts them so outward facing clusters far from the center draw first.
+	void optimizeOverdraw(std::vector<uint32_t>& indices, std::span<const Model::Vertex> vertices,
+		const std::vector<uint32_t>& clusterStarts, float threshold = 1.05f, uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+
+	// Renumbers vertices in order of first use so fetches walk the vertex buffer forward.
+	void optimizeVertexFetch(std::vector<Model::Vertex>& vertices, std::vector<uint32_t>& indices);
+}
@@ -0,0 +1,690 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace
+{
+	constexpr size_t ATTRIBUTE_COUNT = 8;
+	// Attribute differences are weighed against distances in a mesh scaled to a unit extent.
+	constexpr float NORMAL_WEIGHT = 0.5f;
+	constexpr float COLOR_WEIGHT = 0.5f;
+	constexpr float UV_WEIGHT = 0.5f;
+	// Planes through open edges, perpendicular to their triangle, keep borders and seams from drifting.
+	constexpr float BORDER_WEIGHT = 10.0f;
+	constexpr float SEAM_WEIGHT = 1.0f;
+
+	constexpr uint32_t NO_EDGE = ~0u;
+	constexpr uint32_t MULTIPLE_EDGES = ~1u;
+
+	enum class VertexKind : uint8_t
+	{
+		Manifold,
+		// single open edge in, single open edge out, nothing on the other side
+		Border,
+		// two wedges whose open edges meet the other wedge's
+		Seam,
+		Locked
+	};
+
+	// Symmetric 4x4 matrix of the summed squared plane distances; w is the summed weight.
+	struct Quadric
+	{
+		float a00 = 0.0f, a11 = 0.0f, a22 = 0.0f;
+		float a10 = 0.0f, a20 = 0.0f, a21 = 0.0f;
+		float b0 = 0.0f, b1 = 0.0f, b2 = 0.0f;
+		float c = 0.0f;
+		float w = 0.0f;
+
+		void add(const Quadric& q)
+		{
+			a00 += q.a00; a11 += q.a11; a22 += q.a22;
+			a10 += q.a10; a20 += q.a20; a21 += q.a21;
+			b0 += q.b0; b1 += q.b1; b2 += q.b2;
+			c += q.c;
+			w += q.w;
+		}
+		// Adds weight * (dot(n, p) + d)^2; w is left for the caller.
+		void addPlane(const glm::vec3& n, float d, float weight)
+		{
+			a00 += n.x * n.x * weight; a11 += n.y * n.y * weight; a22 += n.z * n.z * weight;
+			a10 += n.y * n.x * weight; a20 += n.z * n.x * weight; a21 += n.z * n.y * weight;
+			b0 += n.x * d * weight; b1 += n.y * d * weight; b2 += n.z * d * weight;
+			c += d * d * weight;
+		}
+		float evaluate(const glm::vec3& p) const
+		{
+			const float rx = a00 * p.x + a10 * p.y + a20 * p.z;
+			const float ry = a10 * p.x + a11 * p.y + a21 * p.z;
+			const float rz = a20 * p.x + a21 * p.y + a22 * p.z;
+			return rx * p.x + ry * p.y + rz * p.z + 2.0f * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+		}
+	};
+
+	// Weighted gradient and offset of one attribute over the triangles around a vertex.
+	struct Gradient
+	{
+		glm::vec3 g{};
+		float d = 0.0f;
+	};
+
+	struct Collapse
+	{
+		uint32_t v0;
+		uint32_t v1;
+		float error;
+	};
+
+	// Outgoing half-edges of every vertex, in compressed row form.
+	struct EdgeAdjacency
+	{
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> targets;
+
+		EdgeAdjacency(const std::vector<uint32_t>& indices, const std::vector<uint32_t>& remap, size_t vertexCount)
+			:
+			offsets(vertexCount + 1, 0),
+			targets(indices.size())
+		{
+			for (uint32_t index : indices)
+			{
+				offsets[remap[index] + 1]++;
+			}
+			std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+			std::vector<uint32_t> cursors(offsets.begin(), offsets.end() - 1);
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				for (size_t k = 0; k < 3; k++)
+				{
+					const uint32_t a = remap[indices[i + k]];
+					const uint32_t b = remap[indices[i + (k + 1) % 3]];
+					targets[cursors[a]++] = b;
+				}
+			}
+		}
+
+		bool hasEdge(uint32_t a, uint32_t b) const
+		{
+			return std::find(targets.begin() + offsets[a], targets.begin() + offsets[a + 1], b) != targets.begin() + offsets[a + 1];
+		}
+	};
+
+	// Triangles around every position group, in compressed row form.
+	struct TriangleAdjacency
+	{
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> triangles;
+
+		TriangleAdjacency(const std::vector<uint32_t>& indices, const std::vector<uint32_t>& remap, size_t vertexCount)
+			:
+			offsets(vertexCount + 1, 0),
+			triangles(indices.size())
+		{
+			for (uint32_t index : indices)
+			{
+				offsets[remap[index] + 1]++;
+			}
+			std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+			std::vector<uint32_t> cursors(offsets.begin(), offsets.end() - 1);
+			for (size_t i = 0; i < indices.size(); i++)
+			{
+				triangles[cursors[remap[indices[i]]]++] = static_cast<uint32_t>(i / 3);
+			}
+		}
+	};
+
+	class Simplifier
+	{
+	public:
+		Simplifier(std::span<const Model::Vertex> vertices, std::span<const uint32_t> indices)
+			:
+			vertexCount(vertices.size()),
+			indices(indices.begin(), indices.end()),
+			positions(vertices.size()),
+			attributes(vertices.size() * ATTRIBUTE_COUNT),
+			remap(vertices.size()),
+			wedges(vertices.size()),
+			kinds(vertices.size(), VertexKind::Locked),
+			vertexQuadrics(vertices.size()),
+			attributeQuadrics(vertices.size()),
+			gradients(vertices.size() * ATTRIBUTE_COUNT)
+		{
+			normalizePositions(vertices);
+			for (size_t v = 0; v < vertexCount; v++)
+			{
+				float* a = &attributes[v * ATTRIBUTE_COUNT];
+				const Model::Vertex& vertex = vertices[v];
+				a[0] = vertex.normal.x * NORMAL_WEIGHT;
+				a[1] = vertex.normal.y * NORMAL_WEIGHT;
+				a[2] = vertex.normal.z * NORMAL_WEIGHT;
+				a[3] = vertex.color.r * COLOR_WEIGHT;
+				a[4] = vertex.color.g * COLOR_WEIGHT;
+				a[5] = vertex.color.b * COLOR_WEIGHT;
+				a[6] = vertex.uv.x * UV_WEIGHT;
+				a[7] = vertex.uv.y * UV_WEIGHT;
+			}
+
+			buildPositionRemap(vertices);
+			updateOpenEdges();
+
+			std::vector<uint32_t> identity(vertexCount);
+			std::iota(identity.begin(), identity.end(), 0);
+			const EdgeAdjacency edges{ this->indices, identity, vertexCount };
+			const EdgeAdjacency positionEdges{ this->indices, remap, vertexCount };
+			classifyVertices(positionEdges);
+			fillQuadrics(edges, positionEdges);
+		}
+
+		void run(size_t targetIndexCount, float targetError)
+		{
+			const float errorLimit = targetError * targetError;
+
+			while (indices.size() > targetIndexCount)
+			{
+				updateOpenEdges();
+				std::vector<Collapse> collapses = pickCollapses(errorLimit);
+				if (collapses.empty())
+				{
+					break;
+				}
+				std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+				// Taking every independent collapse in one pass would also take costly ones whose cheaper
+				// neighbors happened to be locked, so a pass stops near the error its goal calls for.
+				const size_t triangleGoal = (indices.size() - targetIndexCount) / 3;
+				const float passLimit = collapses[std::min(collapses.size() - 1, triangleGoal * 2)].error;
+
+				size_t performed = performCollapses(collapses, passLimit, triangleGoal);
+				if (performed == 0 && passLimit < errorLimit)
+				{
+					performed = performCollapses(collapses, errorLimit, triangleGoal);
+				}
+				if (performed == 0)
+				{
+					break;
+				}
+			}
+		}
+
+		std::vector<uint32_t>& getIndices()
+		{
+			return indices;
+		}
+		// in model units
+		float getError() const
+		{
+			return std::sqrt(maxError) * scale;
+		}
+	private:
+		void normalizePositions(std::span<const Model::Vertex> vertices)
+		{
+			glm::vec3 boundsMin = vertices.empty() ? glm::vec3{} : vertices[0].position;
+			glm::vec3 boundsMax = boundsMin;
+			for (const auto& vertex : vertices)
+			{
+				boundsMin = glm::min(boundsMin, vertex.position);
+				boundsMax = glm::max(boundsMax, vertex.position);
+			}
+
+			const glm::vec3 extent = boundsMax - boundsMin;
+			scale = std::max(extent.x, std::max(extent.y, extent.z));
+			const float invScale = scale > 0.0f ? 1.0f / scale : 0.0f;
+			for (size_t v = 0; v < vertexCount; v++)
+			{
+				positions[v] = (vertices[v].position - boundsMin) * invScale;
+			}
+		}
+
+		// Vertices sharing a position are wedges of one position group, linked in a cycle through wedges.
+		void buildPositionRemap(std::span<const Model::Vertex> vertices)
+		{
+			std::vector<uint32_t> order(vertexCount);
+			std::iota(order.begin(), order.end(), 0);
+			auto less = [&](uint32_t a, uint32_t b)
+			{
+				const glm::vec3& pa = vertices[a].position;
+				const glm::vec3& pb = vertices[b].position;
+				if (pa.x != pb.x) return pa.x < pb.x;
+				if (pa.y != pb.y) return pa.y < pb.y;
+				if (pa.z != pb.z) return pa.z < pb.z;
+				return a < b;
+			};
+			std::sort(order.begin(), order.end(), less);
+
+			for (size_t i = 0; i < vertexCount;)
+			{
+				size_t end = i + 1;
+				while (end < vertexCount && vertices[order[end]].position == vertices[order[i]].position)
+				{
+					end++;
+				}
+				for (size_t k = i; k < end; k++)
+				{
+					remap[order[k]] = order[i];
+					wedges[order[k]] = order[k + 1 < end ? k + 1 : i];
+				}
+				i = end;
+			}
+		}
+
+		// A half-edge is open when no triangle walks it the other way.
+		void updateOpenEdges()
+		{
+			std::vector<uint32_t> identity(vertexCount);
+			std::iota(identity.begin(), identity.end(), 0);
+			const EdgeAdjacency adjacency{ indices, identity, vertexCount };
+
+			openOut.assign(vertexCount, NO_EDGE);
+			openIn.assign(vertexCount, NO_EDGE);
+			auto record = [](uint32_t& slot, uint32_t vertex)
+			{
+				slot = (slot == NO_EDGE || slot == vertex) ? vertex : MULTIPLE_EDGES;
+			};
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				for (size_t k = 0; k < 3; k++)
+				{
+					const uint32_t a = indices[i + k];
+					const uint32_t b = indices[i + (k + 1) % 3];
+					if (!adjacency.hasEdge(b, a))
+					{
+						record(openOut[a], b);
+						record(openIn[b], a);
+					}
+				}
+			}
+		}
+
+		bool isEdge(uint32_t vertex) const
+		{
+			return vertex != NO_EDGE && vertex != MULTIPLE_EDGES;
+		}
+
+		// An open edge with nothing across it at all is a border, otherwise a seam.
+		bool isBorderEdge(const EdgeAdjacency& positionEdges, uint32_t a, uint32_t b) const
+		{
+			return !positionEdges.hasEdge(remap[b], remap[a]);
+		}
+
+		void classifyVertices(const EdgeAdjacency& positionEdges)
+		{
+			auto isBorder = [&](uint32_t a, uint32_t b)
+			{
+				return isBorderEdge(positionEdges, a, b);
+			};
+
+			for (uint32_t v = 0; v < vertexCount; v++)
+			{
+				if (remap[v] != v)
+				{
+					continue;
+				}
+
+				VertexKind kind = VertexKind::Locked;
+				const uint32_t w = wedges[v];
+				if (w == v)
+				{
+					if (openOut[v] == NO_EDGE && openIn[v] == NO_EDGE)
+					{
+						kind = VertexKind::Manifold;
+					}
+					else if (isEdge(openOut[v]) && isEdge(openIn[v]) &&
+						isBorder(v, openOut[v]) && isBorder(openIn[v], v))
+					{
+						kind = VertexKind::Border;
+					}
+				}
+				else if (wedges[w] == v &&
+					isEdge(openOut[v]) && isEdge(openIn[v]) && isEdge(openOut[w]) && isEdge(openIn[w]) &&
+					!isBorder(v, openOut[v]) && !isBorder(openIn[v], v) &&
+					remap[openOut[v]] == remap[openIn[w]] && remap[openIn[v]] == remap[openOut[w]])
+				{
+					kind = VertexKind::Seam;
+				}
+
+				uint32_t wedge = v;
+				do
+				{
+					kinds[wedge] = kind;
+					wedge = wedges[wedge];
+				} while (wedge != v);
+			}
+		}
+
+		void fillQuadrics(const EdgeAdjacency& edges, const EdgeAdjacency& positionEdges)
+		{
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				const uint32_t corners[3] = { indices[i], indices[i + 1], indices[i + 2] };
+				const glm::vec3& p0 = positions[corners[0]];
+				const glm::vec3 p10 = positions[corners[1]] - p0;
+				const glm::vec3 p20 = positions[corners[2]] - p0;
+
+				glm::vec3 normal = glm::cross(p10, p20);
+				const float length = glm::length(normal);
+				if (length == 0.0f)
+				{
+					continue;
+				}
+				normal /= length;
+				const float area = length * 0.5f;
+
+				Quadric plane{};
+				plane.addPlane(normal, -glm::dot(normal, p0), area);
+				plane.w = area;
+				for (uint32_t corner : corners)
+				{
+					vertexQuadrics[remap[corner]].add(plane);
+				}
+
+				addAttributeQuadrics(corners, p10, p20, area);
+
+				for (size_t k = 0; k < 3; k++)
+				{
+					const uint32_t a = corners[k];
+					const uint32_t b = corners[(k + 1) % 3];
+					if (edges.hasEdge(b, a))
+					{
+						continue;
+					}
+
+					const glm::vec3 edge = positions[b] - positions[a];
+					const float edgeLength = glm::length(edge);
+					if (edgeLength == 0.0f)
+					{
+						continue;
+					}
+					const glm::vec3 edgeNormal = glm::normalize(glm::cross(edge, normal));
+					const float weight = edgeLength * edgeLength * (isBorderEdge(positionEdges, a, b) ? BORDER_WEIGHT : SEAM_WEIGHT);
+
+					Quadric edgePlane{};
+					edgePlane.addPlane(edgeNormal, -glm::dot(edgeNormal, positions[a]), weight);
+					edgePlane.w = weight;
+					vertexQuadrics[remap[a]].add(edgePlane);
+					vertexQuadrics[remap[b]].add(edgePlane);
+				}
+			}
+		}
+
+		// Each attribute varies linearly over the triangle; its gradient g and offset d give the value
+		// dot(g, p) + d, and the quadric measures the squared difference to a vertex's own value.
+		void addAttributeQuadrics(const uint32_t (&corners)[3], const glm::vec3& p10, const glm::vec3& p20, float area)
+		{
+			const float d00 = glm::dot(p10, p10);
+			const float d01 = glm::dot(p10, p20);
+			const float d11 = glm::dot(p20, p20);
+			const float denominator = d00 * d11 - d01 * d01;
+			if (denominator == 0.0f)
+			{
+				return;
+			}
+			const glm::vec3 g1 = (d11 * p10 - d01 * p20) / denominator;
+			const glm::vec3 g2 = (d00 * p20 - d01 * p10) / denominator;
+			const glm::vec3& p0 = positions[corners[0]];
+
+			Quadric quadric{};
+			Gradient triangleGradients[ATTRIBUTE_COUNT];
+			for (size_t k = 0; k < ATTRIBUTE_COUNT; k++)
+			{
+				const float a0 = attributes[corners[0] * ATTRIBUTE_COUNT + k];
+				const float a1 = attributes[corners[1] * ATTRIBUTE_COUNT + k];
+				const float a2 = attributes[corners[2] * ATTRIBUTE_COUNT + k];
+
+				const glm::vec3 g = g1 * (a1 - a0) + g2 * (a2 - a0);
+				const float d = a0 - glm::dot(g, p0);
+				quadric.addPlane(g, d, area);
+				triangleGradients[k] = { g * area, d * area };
+			}
+			quadric.w = area;
+
+			for (uint32_t corner : corners)
+			{
+				attributeQuadrics[corner].add(quadric);
+				for (size_t k = 0; k < ATTRIBUTE_COUNT; k++)
+				{
+					Gradient& gradient = gradients[corner * ATTRIBUTE_COUNT + k];
+					gradient.g += triangleGradients[k].g;
+					gradient.d += triangleGradients[k].d;
+				}
+			}
+		}
+
+		// Error of moving vertex onto target's position and attributes.
+		float collapseError(uint32_t vertex, uint32_t target, bool withPosition) const
+		{
+			const glm::vec3& p = positions[target];
+			float error = 0.0f;
+			if (withPosition)
+			{
+				const Quadric& q = vertexQuadrics[remap[vertex]];
+				error = q.w > 0.0f ? std::abs(q.evaluate(p)) / q.w : 0.0f;
+			}
+
+			const Quadric& q = attributeQuadrics[vertex];
+			if (q.w > 0.0f)
+			{
+				float r = q.evaluate(p);
+				for (size_t k = 0; k < ATTRIBUTE_COUNT; k++)
+				{
+					const float a = attributes[target * ATTRIBUTE_COUNT + k];
+					const Gradient& gradient = gradients[vertex * ATTRIBUTE_COUNT + k];
+					r += q.w * a * a - 2.0f * a * (glm::dot(gradient.g, p) + gradient.d);
+				}
+				error += std::abs(r) / q.w;
+			}
+			return error;
+		}
+
+		// The wedge the other side of a seam collapses onto when v0 collapses onto v1.
+		uint32_t seamTarget(uint32_t v0, uint32_t v1) const
+		{
+			const uint32_t w0 = wedges[v0];
+			const uint32_t w1 = v1 == openOut[v0] ? openIn[w0] : openOut[w0];
+			return isEdge(w1) && remap[w1] == remap[v1] && w1 != v1 ? w1 : NO_EDGE;
+		}
+
+		bool canCollapse(uint32_t v0, uint32_t v1) const
+		{
+			switch (kinds[v0])
+			{
+			case VertexKind::Manifold:
+				return true;
+			case VertexKind::Border:
+				return kinds[v1] == VertexKind::Border && (openOut[v0] == v1 || openIn[v0] == v1);
+			case VertexKind::Seam:
+				return kinds[v1] == VertexKind::Seam && (openOut[v0] == v1 || openIn[v0] == v1) && seamTarget(v0, v1) != NO_EDGE;
+			default:
+				return false;
+			}
+		}
+
+		std::vector<Collapse> pickCollapses(float errorLimit) const
+		{
+			std::vector<Collapse> collapses;
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				for (size_t k = 0; k < 3; k++)
+				{
+					const uint32_t v0 = indices[i + k];
+					const uint32_t v1 = indices[i + (k + 1) % 3];
+					if (remap[v0] == remap[v1])
+					{
+						continue;
+					}
+
+					// both directions of every edge, the opposite triangle contributes its own
+					for (const auto& [from, to] : { std::pair{ v0, v1 }, std::pair{ v1, v0 } })
+					{
+						if (!canCollapse(from, to))
+						{
+							continue;
+						}
+						float error = collapseError(from, to, true);
+						if (kinds[from] == VertexKind::Seam)
+						{
+							error += collapseError(wedges[from], seamTarget(from, to), false);
+						}
+						if (error <= errorLimit)
+						{
+							collapses.push_back({ from, to, error });
+						}
+					}
+				}
+			}
+			return collapses;
+		}
+
+		size_t performCollapses(const std::vector<Collapse>& collapses, float errorLimit, size_t triangleGoal)
+		{
+			std::vector<uint32_t> collapseRemap(vertexCount);
+			std::iota(collapseRemap.begin(), collapseRemap.end(), 0);
+			std::vector<bool> locked(vertexCount, false);
+			const TriangleAdjacency adjacency{ indices, remap, vertexCount };
+
+			auto lockGroup = [&](uint32_t v)
+			{
+				uint32_t wedge = v;
+				do
+				{
+					locked[wedge] = true;
+					wedge = wedges[wedge];
+				} while (wedge != v);
+			};
+
+			size_t performed = 0;
+			size_t trianglesRemoved = 0;
+			for (const Collapse& collapse : collapses)
+			{
+				if (collapse.error > errorLimit || trianglesRemoved >= triangleGoal)
+				{
+					break;
+				}
+				const uint32_t v0 = collapse.v0;
+				const uint32_t v1 = collapse.v1;
+				if (locked[v0] || locked[v1] || hasTriangleFlips(adjacency, collapseRemap, v0, v1))
+				{
+					continue;
+				}
+
+				collapseRemap[v0] = v1;
+				vertexQuadrics[remap[v1]].add(vertexQuadrics[remap[v0]]);
+				mergeAttributes(v0, v1);
+				if (kinds[v0] == VertexKind::Seam)
+				{
+					const uint32_t w0 = wedges[v0];
+					const uint32_t w1 = seamTarget(v0, v1);
+					collapseRemap[w0] = w1;
+					mergeAttributes(w0, w1);
+				}
+
+				lockGroup(v0);
+				lockGroup(v1);
+				maxError = std::max(maxError, collapse.error);
+				trianglesRemoved += kinds[v0] == VertexKind::Border ? 1 : 2;
+				performed++;
+			}
+
+			size_t write = 0;
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				const uint32_t a = collapseRemap[indices[i]];
+				const uint32_t b = collapseRemap[indices[i + 1]];
+				const uint32_t c = collapseRemap[indices[i + 2]];
+				if (remap[a] == remap[b] || remap[b] == remap[c] || remap[c] == remap[a])
+				{
+					continue;
+				}
+				indices[write++] = a;
+				indices[write++] = b;
+				indices[write++] = c;
+			}
+			indices.resize(write);
+
+			return performed;
+		}
+
+		void mergeAttributes(uint32_t from, uint32_t to)
+		{
+			attributeQuadrics[to].add(attributeQuadrics[from]);
+			for (size_t k = 0; k < ATTRIBUTE_COUNT; k++)
+			{
+				gradients[to * ATTRIBUTE_COUNT + k].g += gradients[from * ATTRIBUTE_COUNT + k].g;
+				gradients[to * ATTRIBUTE_COUNT + k].d += gradients[from * ATTRIBUTE_COUNT + k].d;
+			}
+		}
+
+		// Whether moving v0's group onto v1 turns any surviving triangle around.
+		bool hasTriangleFlips(const TriangleAdjacency& adjacency, const std::vector<uint32_t>& collapseRemap,
+			uint32_t v0, uint32_t v1) const
+		{
+			const uint32_t group0 = remap[v0];
+			const uint32_t group1 = remap[v1];
+			for (uint32_t t = adjacency.offsets[group0]; t < adjacency.offsets[group0 + 1]; t++)
+			{
+				const uint32_t triangle = adjacency.triangles[t];
+				uint32_t corners[3];
+				for (size_t k = 0; k < 3; k++)
+				{
+					corners[k] = collapseRemap[indices[triangle * 3 + k]];
+				}
+				if (remap[corners[0]] == group1 || remap[corners[1]] == group1 || remap[corners[2]] == group1)
+				{
+					continue;
+				}
+
+				// measured against the triangle as the pass found it, so collapses of its other corners add up
+				glm::vec3 before[3];
+				glm::vec3 after[3];
+				for (size_t k = 0; k < 3; k++)
+				{
+					before[k] = positions[indices[triangle * 3 + k]];
+					after[k] = remap[corners[k]] == group0 ? positions[v1] : positions[corners[k]];
+				}
+				const glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+				const glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+				// Nearly turning over or collapsing to a line counts too, later collapses could finish the job.
+				const float lengthBefore = glm::length(normalBefore);
+				const float lengthAfter = glm::length(normalAfter);
+				if (glm::dot(normalBefore, normalAfter) <= 0.25f * lengthBefore * lengthAfter || lengthAfter < 1e-3f * lengthBefore)
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+	private:
+		size_t vertexCount;
+		std::vector<uint32_t> indices;
+		std::vector<glm::vec3> positions;
+		std::vector<float> attributes;
+		float scale = 1.0f;
+
+		std::vector<uint32_t> remap;
+		std::vector<uint32_t> wedges;
+		std::vector<VertexKind> kinds;
+		std::vector<uint32_t> openOut;
+		std::vector<uint32_t> openIn;
+
+		// position quadrics are per position group, attribute quadrics per wedge
+		std::vector<Quadric> vertexQuadrics;
+		std::vector<Quadric> attributeQuadrics;
+		std::vector<Gradient> gradients;
+		float maxError = 0.0f;
+	};
+}
+
+std::vector<uint32_t> MeshSimplifier::simplify(std::span<const Model::Vertex> vertices, std::span<const uint32_t> indices,
+	size_t targetIndexCount, float targetError, float* resultError)
+{
+	Simplifier simplifier{ vertices, indices };
+	simplifier.run(targetIndexCount, targetError);
+
+	if (resultError)
+	{
+		*resultError = simplifier.getError();
+	}
+	return std::move(simplifier.getIndices());
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "Model.h"
+#include <span>
+#include <vector>
+
+// Quadric error edge collapse (Garland and Heckbert 1997) with attribute quadrics
+// for normals, colors and uvs (Hoppe 1999). Vertices only ever collapse onto other
+// existing vertices, so the result indexes the same vertex buffer as its input.
+// Borders and attribute seams only collapse along themselves; anything more tangled is locked.
+namespace MeshSimplifier
+{
+	// Collapses edges until at most targetIndexCount indices are left or the next collapse would
+	// exceed targetError, relative to the mesh extent. resultError receives the largest error
+	// reached, in model units.
+	std::vector<uint32_t> simplify(std::span<const Model::Vertex> vertices, std::span<const uint32_t> indices,
+		size_t targetIndexCount, float targetError, float* resultError = nullptr);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// A cluster of a model's triangles, drawn as one contiguous index range so whole clusters
+// can be culled. Laid out to match a std430 storage buffer.
+struct Meshlet
+{
+	static constexpr uint32_t MAX_VERTICES = 64;
+	static constexpr uint32_t MAX_TRIANGLES = 124;
+
+	// bounding sphere, in model space
+	glm::vec3 center{};
+	float radius = 0.0f;
+	// Normal cone of the counter-clockwise triangles: all of them face away from an eye at e when
+	// dot(center - e, coneAxis) >= coneCutoff * length(center - e) + radius. A cutoff of 1 never culls.
+	glm::vec3 coneAxis{};
+	float coneCutoff = 1.0f;
+	// relative to the model's first index
+	uint32_t firstIndex = 0;
+	uint32_t indexCount = 0;
+	uint32_t padding[2]{};
+};
@@ -0,0 +1,190 @@
+#include "MeshletBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace
+{
+	// Triangles around every vertex, in compressed row form.
+	struct Adjacency
+	{
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> triangles;
+
+		Adjacency(std::span<const uint32_t> indices, size_t vertexCount)
+			:
+			offsets(vertexCount + 1, 0),
+			triangles(indices.size())
+		{
+			for (uint32_t index : indices)
+			{
+				offsets[index + 1]++;
+			}
+			std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+			std::vector<uint32_t> cursors(offsets.begin(), offsets.end() - 1);
+			for (size_t i = 0; i < indices.size(); i++)
+			{
+				triangles[cursors[indices[i]]++] = static_cast<uint32_t>(i / 3);
+			}
+		}
+	};
+
+	void computeBounds(Meshlet& meshlet, std::span<const uint32_t> meshletIndices, const std::vector<uint32_t>& meshletVertices,
+		std::span<const Model::Vertex> vertices)
+	{
+		glm::vec3 boundsMin = vertices[meshletVertices[0]].position;
+		glm::vec3 boundsMax = boundsMin;
+		for (uint32_t vertex : meshletVertices)
+		{
+			boundsMin = glm::min(boundsMin, vertices[vertex].position);
+			boundsMax = glm::max(boundsMax, vertices[vertex].position);
+		}
+		meshlet.center = (boundsMin + boundsMax) * 0.5f;
+		meshlet.radius = 0.0f;
+		for (uint32_t vertex : meshletVertices)
+		{
+			meshlet.radius = std::max(meshlet.radius, glm::length(vertices[vertex].position - meshlet.center));
+		}
+
+		std::vector<glm::vec3> normals;
+		normals.reserve(meshletIndices.size() / 3);
+		glm::vec3 normalSum{};
+		for (size_t i = 0; i < meshletIndices.size(); i += 3)
+		{
+			const glm::vec3& p0 = vertices[meshletIndices[i]].position;
+			const glm::vec3 normal = glm::cross(vertices[meshletIndices[i + 1]].position - p0, vertices[meshletIndices[i + 2]].position - p0);
+			const float length = glm::length(normal);
+			if (length > 0.0f)
+			{
+				normals.push_back(normal / length);
+				normalSum += normals.back();
+			}
+		}
+
+		const float sumLength = glm::length(normalSum);
+		if (normals.empty() || sumLength < 1e-6f)
+		{
+			return;
+		}
+		meshlet.coneAxis = normalSum / sumLength;
+
+		float minDot = 1.0f;
+		for (const glm::vec3& normal : normals)
+		{
+			minDot = std::min(minDot, glm::dot(normal, meshlet.coneAxis));
+		}
+		// a cone wider than a hemisphere has no view direction all of it faces away from
+		meshlet.coneCutoff = minDot <= 0.0f ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+	}
+}
+
+std::vector<Meshlet> MeshletBuilder::build(std::vector<uint32_t>& indices, std::span<const Model::Vertex> vertices,
+	uint32_t maxVertices, uint32_t maxTriangles)
+{
+	std::vector<Meshlet> meshlets;
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return meshlets;
+	}
+
+	const Adjacency adjacency{ indices, vertices.size() };
+	std::vector<bool> emitted(triangleCount, false);
+	// meshlet number + 1 of the meshlet a vertex was last added to
+	std::vector<uint32_t> vertexStamps(vertices.size(), 0);
+	uint32_t stamp = 1;
+
+	std::vector<uint32_t> reordered;
+	reordered.reserve(indices.size());
+	std::vector<uint32_t> meshletVertices;
+	size_t nextSeed = 0;
+
+	auto newVertexCount = [&](uint32_t triangle)
+	{
+		const uint32_t* corners = &indices[triangle * 3];
+		uint32_t count = 0;
+		for (uint32_t k = 0; k < 3; k++)
+		{
+			// repeated corners of degenerate triangles count once
+			const bool repeated = (k > 0 && corners[k] == corners[0]) || (k > 1 && corners[k] == corners[1]);
+			count += vertexStamps[corners[k]] != stamp && !repeated;
+		}
+		return count;
+	};
+
+	auto flush = [&]()
+	{
+		Meshlet meshlet{};
+		meshlet.firstIndex = meshlets.empty() ? 0 : meshlets.back().firstIndex + meshlets.back().indexCount;
+		meshlet.indexCount = static_cast<uint32_t>(reordered.size()) - meshlet.firstIndex;
+		computeBounds(meshlet, std::span<const uint32_t>{ reordered }.subspan(meshlet.firstIndex, meshlet.indexCount), meshletVertices, vertices);
+		meshlets.push_back(meshlet);
+
+		meshletVertices.clear();
+		stamp++;
+	};
+
+	for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+	{
+		// the triangle around the meshlet's vertices that adds the fewest new ones
+		uint32_t best = ~0u;
+		uint32_t bestNew = 4;
+		for (uint32_t vertex : meshletVertices)
+		{
+			for (uint32_t t = adjacency.offsets[vertex]; t < adjacency.offsets[vertex + 1] && bestNew > 0; t++)
+			{
+				const uint32_t triangle = adjacency.triangles[t];
+				if (emitted[triangle])
+				{
+					continue;
+				}
+				const uint32_t added = newVertexCount(triangle);
+				if (added < bestNew)
+				{
+					best = triangle;
+					bestNew = added;
+				}
+			}
+			if (bestNew == 0)
+			{
+				break;
+			}
+		}
+
+		// nothing connected left, continue with the next triangle in the input order
+		if (best == ~0u)
+		{
+			while (emitted[nextSeed])
+			{
+				nextSeed++;
+			}
+			best = static_cast<uint32_t>(nextSeed);
+			bestNew = newVertexCount(best);
+		}
+
+		const uint32_t meshletTriangles = static_cast<uint32_t>(reordered.size() / 3) -
+			(meshlets.empty() ? 0 : (meshlets.back().firstIndex + meshlets.back().indexCount) / 3);
+		if (meshletTriangles == maxTriangles || meshletVertices.size() + bestNew > maxVertices)
+		{
+			flush();
+		}
+
+		emitted[best] = true;
+		for (uint32_t k = 0; k < 3; k++)
+		{
+			const uint32_t vertex = indices[best * 3 + k];
+			if (vertexStamps[vertex] != stamp)
+			{
+				vertexStamps[vertex] = stamp;
+				meshletVertices.push_back(vertex);
+			}
+			reordered.push_back(vertex);
+		}
+	}
+	flush();
+
+	indices = std::move(reordered);
+	return meshlets;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "Meshlet.h"
+#include "Model.h"
+#include <span>
+#include <vector>
+
+namespace MeshletBuilder
+{
+	// Splits the triangles into meshlets of at most maxVertices unique vertices and maxTriangles triangles,
+	// growing each one from the triangles that add the fewest new vertices, and reorders indices so
+	// every meshlet is a contiguous range. Run it after the vertex cache pass, it keeps that locality.
+	std::vector<Meshlet> build(std::vector<uint32_t>& indices, std::span<const Model::Vertex> vertices,
+		uint32_t maxVertices = Meshlet::MAX_VERTICES, uint32_t maxTriangles = Meshlet::MAX_TRIANGLES);
+}
@@ -1,148 +1,210 @@
 #include "Model.h"
-#include "Utils.h"
-
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tiny_obj_loader.h>
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
-
+#include "MeshCache.h"
+#include "MeshletBuilder.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "ObjLoader.h"
+#include "VertexDeduplication.h"
+#include "VertexQuantization.h"
+
+#include <algorithm>
 #include<cassert>
-#include <unordered_map>
+#include <cstring>
 
-namespace std
+namespace
 {
-	template<> struct hash<Model::Vertex>
-	{
-		size_t operator()(const Model::Vertex& vertex) const
-		{
-			size_t seed = 0;
-			hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
-			return seed;
-		}
-	};
+	// Below this many corners splitting the dedup across threads costs more than it saves.
+	constexpr size_t PARALLEL_DEDUP_MIN_CORNERS = 1 << 20;
 }
 
-Model::Model(EngineDevice& device, const Builder& builder)
+Model::Model(GeometryPool& geometryPool, const Builder& builder, VertexFormat vertexFormat)
 	:
-	device(device)
+	Model(geometryPool, builder.getMeshData(), vertexFormat)
 {
-	createVertexBuffers(builder.vertices);
-	createIndexBuffers(builder.indices);
 }
 
-Model::~Model()
+Model::Model(GeometryPool& geometryPool, const MeshData& data, VertexFormat vertexFormat)
+	:
+	geometryPool(geometryPool),
+	vertexFormat(vertexFormat),
+	lods(data.lods.begin(), data.lods.end()),
+	meshlets(data.meshlets.begin(), data.meshlets.end()),
+	bounds(data.bounds)
 {
-	vkDestroyBuffer(device.device(), vertexBuffer, nullptr);
-	vkFreeMemory(device.device(), vertexBufferMemory, nullptr);
+	const std::span<const Vertex> vertices = data.vertices;
+	const std::span<const uint32_t> indices = data.indices;
+	assert(vertices.size() >= 3 && "Vertex count must be at least 3");
+	assert(geometryPool.getVertexStride() == vertexStride(vertexFormat) && "Geometry pool stride does not match the vertex format!");
 
-	if (hasIndexBuffer)
+	if (lods.empty())
 	{
-		vkDestroyBuffer(device.device(), indexBuffer, nullptr);
-		vkFreeMemory(device.device(), indexBufferMemory, nullptr);
+		lods.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.0f });
 	}
-}
 
-std::unique_ptr<Model> Model::createModelFromFile(EngineDevice& device, const std::string& filepath)
-{
-	Builder builder{};
-	builder.loadModel(filepath);
-	return std::make_unique<Model>(device, builder);
+	// Halves the index memory and bandwidth of every model small enough for 16-bit indices.
+	// They are narrowed straight into staging, so a mapped cache is read once and never copied on the heap.
+	const VkIndexType indexType = indexTypeFor(vertices.size());
+	range = geometryPool.allocate(
+		[&](void* destination)
+		{
+			// packed models are quantized straight into staging
+			if (vertexFormat == VertexFormat::Packed)
+			{
+				VertexQuantization::packVertices(vertices, static_cast<PackedVertex*>(destination), decodeMatrix, &quantizationError);
+			}
+			else
+			{
+				memcpy(destination, vertices.data(), vertices.size_bytes());
+			}
+		},
+		static_cast<uint32_t>(vertices.size()),
+		[&](void* destination)
+		{
+			if (indexType == VK_INDEX_TYPE_UINT16)
+			{
+				uint16_t* shortIndices = static_cast<uint16_t*>(destination);
+				for (size_t i = 0; i < indices.size(); i++)
+				{
+					shortIndices[i] = static_cast<uint16_t>(indices[i]);
+				}
+			}
+			else
+			{
+				memcpy(destination, indices.data(), indices.size_bytes());
+			}
+		},
+		static_cast<uint32_t>(indices.size()),
+		indexType,
+		meshlets.data(),
+		static_cast<uint32_t>(meshlets.size()));
 }
 
-void Model::bind(VkCommandBuffer commandBuffer)
+Model::~Model()
 {
-	VkBuffer buffers[] = { vertexBuffer };
-	VkDeviceSize offsets[] = {0};
-	vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
-
-	if (hasIndexBuffer)
-	{
-		vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
-	}
+	geometryPool.free(range);
 }
 
-void Model::draw(VkCommandBuffer commandBuffer)
+std::unique_ptr<Model> Model::createModelFromFile(GeometryPool& geometryPool, const std::string& filepath, const LoadOptions& options)
 {
-	if (hasIndexBuffer)
+	// The mapped cache is copied straight into the staging ring.
+	MeshCache cache{ filepath, MeshCache::flagsFor(options) };
+	std::unique_ptr<Model> model;
+	if (cache.isValid())
 	{
-		vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+		model = std::make_unique<Model>(geometryPool, cache.getMeshData(), options.vertexFormat);
 	}
 	else
 	{
-		vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+		// the invalid cache holds no mapping, so the builder may replace it
+		Builder builder{};
+		builder.loadSource(filepath, options);
+		model = std::make_unique<Model>(geometryPool, builder, options.vertexFormat);
 	}
+
+	if (options.report && options.vertexFormat == VertexFormat::Packed)
+	{
+		const QuantizationError& error = model->getQuantizationError();
+		*options.report << filepath << ": packed to " << sizeof(PackedVertex) << " of " << sizeof(Vertex)
+			<< " bytes per vertex, max error position " << error.position
+			<< ", normal " << error.normalDegrees << " deg, color " << error.color
+			<< ", uv " << error.uv << std::endl;
+	}
+	return model;
 }
 
-void Model::createVertexBuffers(const std::vector<Vertex>& vertices)
+VkDeviceSize Model::vertexStride(VertexFormat vertexFormat)
 {
-	vertexCount = static_cast<uint32_t>(vertices.size());
-	assert(vertexCount >= 3 && "Vertex count must be at least 3");
-	VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
-
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-	device.createBuffer(
-		bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		stagingBuffer,
-		stagingBufferMemory);
-
-	void* data;
-	vkMapMemory(device.device(), stagingBufferMemory, 0, bufferSize, 0, &data);
-	memcpy(data, vertices.data(), static_cast<size_t>(bufferSize));
-	vkUnmapMemory(device.device(), stagingBufferMemory);
-
-	device.createBuffer(
-		bufferSize,
-		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		vertexBuffer,
-		vertexBufferMemory);
-
-	device.copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
-
-	vkDestroyBuffer(device.device(), stagingBuffer, nullptr);
-	vkFreeMemory(device.device(), stagingBufferMemory, nullptr);
+	return vertexFormat == VertexFormat::Packed ? sizeof(PackedVertex) : sizeof(Vertex);
 }
 
-void Model::createIndexBuffers(const std::vector<uint32_t>& indices)
+ModelBounds Model::computeBounds(std::span<const Vertex> vertices)
 {
-	indexCount = static_cast<uint32_t>(indices.size());
-	hasIndexBuffer = indexCount > 0;
+	ModelBounds bounds{};
+	if (vertices.empty())
+	{
+		return bounds;
+	}
 
-	if (!hasIndexBuffer)
+	// Extremes along each axis, the box comes for free.
+	size_t minIndex[3] = {};
+	size_t maxIndex[3] = {};
+	for (size_t i = 0; i < vertices.size(); i++)
 	{
-		return;
+		const glm::vec3& p = vertices[i].position;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			minIndex[axis] = p[axis] < vertices[minIndex[axis]].position[axis] ? i : minIndex[axis];
+			maxIndex[axis] = p[axis] > vertices[maxIndex[axis]].position[axis] ? i : maxIndex[axis];
+		}
+	}
+	for (int axis = 0; axis < 3; axis++)
+	{
+		bounds.box.min[axis] = vertices[minIndex[axis]].position[axis];
+		bounds.box.max[axis] = vertices[maxIndex[axis]].position[axis];
 	}
 
-	VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
+	// Ritter (1990): start from the most distant pair of extremes and grow to take in every outlier.
+	int widest = 0;
+	float widestDistance = -1.0f;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		const glm::vec3 span = vertices[maxIndex[axis]].position - vertices[minIndex[axis]].position;
+		if (glm::dot(span, span) > widestDistance)
+		{
+			widest = axis;
+			widestDistance = glm::dot(span, span);
+		}
+	}
+	BoundingSphere sphere{};
+	sphere.center = (vertices[minIndex[widest]].position + vertices[maxIndex[widest]].position) * 0.5f;
+	sphere.radius = std::sqrt(widestDistance) * 0.5f;
+	for (const Vertex& vertex : vertices)
+	{
+		const glm::vec3 offset = vertex.position - sphere.center;
+		const float distance = glm::length(offset);
+		if (distance > sphere.radius)
+		{
+			const float newRadius = (sphere.radius + distance) * 0.5f;
+			sphere.center += offset * ((newRadius - sphere.radius) / distance);
+			sphere.radius = newRadius;
+		}
+	}
 
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-	device.createBuffer(
-		bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		stagingBuffer,
-		stagingBufferMemory);
+	const BoundingSphere boxSphere{ bounds.box.center(), glm::length(bounds.box.extent()) };
+	bounds.sphere = boxSphere.radius < sphere.radius ? boxSphere : sphere;
+	return bounds;
+}
 
-	void* data;
-	vkMapMemory(device.device(), stagingBufferMemory, 0, bufferSize, 0, &data);
-	memcpy(data, indices.data(), static_cast<size_t>(bufferSize));
-	vkUnmapMemory(device.device(), stagingBufferMemory);
+void Model::bind(VkCommandBuffer commandBuffer)
+{
+	geometryPool.bind(commandBuffer, getIndexType());
+}
 
-	device.createBuffer(
-		bufferSize,
-		VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		indexBuffer,
-		indexBufferMemory);
+void Model::bind(CommandRecorder& recorder)
+{
+	geometryPool.bind(recorder, getIndexType());
+}
 
-	device.copyBuffer(stagingBuffer, indexBuffer, bufferSize);
+void Model::draw(VkCommandBuffer commandBuffer, uint32_t lod, uint32_t instanceCount, uint32_t firstInstance)
+{
+	const GeometryPool::Range& r = getRange();
+	if (r.indexCount > 0)
+	{
+		vkCmdDrawIndexed(commandBuffer, lods[lod].indexCount, instanceCount, r.firstIndex + lods[lod].firstIndex, r.vertexOffset(), firstInstance);
+	}
+	else
+	{
+		vkCmdDraw(commandBuffer, r.vertexCount, instanceCount, r.firstVertex, firstInstance);
+	}
+}
 
-	vkDestroyBuffer(device.device(), stagingBuffer, nullptr);
-	vkFreeMemory(device.device(), stagingBufferMemory, nullptr);
+void Model::drawMeshlets(VkCommandBuffer commandBuffer, uint32_t firstMeshlet, uint32_t meshletCount, uint32_t firstInstance)
+{
+	const GeometryPool::Range& r = getRange();
+	const Meshlet& first = meshlets[firstMeshlet];
+	const Meshlet& last = meshlets[firstMeshlet + meshletCount - 1];
+	vkCmdDrawIndexed(commandBuffer, last.firstIndex + last.indexCount - first.firstIndex, 1,
+		r.firstIndex + first.firstIndex, r.vertexOffset(), firstInstance);
 }
 
 std::vector<VkVertexInputBindingDescription> Model::Vertex::getBindingDescriptions()
@@ -167,65 +229,228 @@ std::vector<VkVertexInputAttributeDescription> Model::Vertex::getAttributeDescri
 	return attributeDescriptions;
 }
 
-void Model::Builder::loadModel(const std::string& filepath)
+std::vector<VkVertexInputBindingDescription> Model::PackedVertex::getBindingDescriptions()
 {
-	tinyobj::attrib_t attribute;
-	std::vector<tinyobj::shape_t> shapes;
-	std::vector<tinyobj::material_t> materials;
-	std::string warn, err;
+	std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+	bindingDescriptions[0].binding = 0;
+	bindingDescriptions[0].stride = sizeof(PackedVertex);
+	bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
-	if (!tinyobj::LoadObj(&attribute, &shapes, &materials, &warn, &err, filepath.c_str()))
-		throw std::runtime_error(warn + err);
+	return bindingDescriptions;
+}
+
+std::vector<VkVertexInputAttributeDescription> Model::PackedVertex::getAttributeDescriptions()
+{
+	std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
+
+	attributeDescriptions.push_back({ 0, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(PackedVertex, position) });
+	attributeDescriptions.push_back({ 1, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(PackedVertex, color) });
+	attributeDescriptions.push_back({ 2, 0, VK_FORMAT_R16G16_SNORM, offsetof(PackedVertex, normal) });
+	attributeDescriptions.push_back({ 3, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(PackedVertex, uv) });
+
+	return attributeDescriptions;
+}
+
+void Model::Builder::loadModel(const std::string& filepath, const LoadOptions& options)
+{
+	// the cache is unmapped before it may be rewritten below
+	{
+		MeshCache cache{ filepath, MeshCache::flagsFor(options) };
+		if (cache.isValid())
+		{
+			vertices.assign(cache.getVertices().begin(), cache.getVertices().end());
+			indices.assign(cache.getIndices().begin(), cache.getIndices().end());
+			lods.assign(cache.getLods().begin(), cache.getLods().end());
+			meshlets.assign(cache.getMeshlets().begin(), cache.getMeshlets().end());
+			bounds = cache.getBounds();
+			return;
+		}
+	}
+	loadSource(filepath, options);
+}
+
+void Model::Builder::loadSource(const std::string& filepath, const LoadOptions& options)
+{
+	ThreadPool* threadPool = options.threadPool;
+	ObjLoader::Mesh mesh = ObjLoader{ threadPool }.load(filepath);
 
 	vertices.clear();
 	indices.clear();
+	lods.clear();
+	meshlets.clear();
 
-	std::unordered_map<Vertex, uint32_t> uniqueVertices;
+	if (threadPool && threadPool->getThreadCount() > 1 && mesh.corners.size() >= PARALLEL_DEDUP_MIN_CORNERS)
+	{
+		VertexDeduplication::deduplicateParallel(mesh, *threadPool, vertices, indices);
+	}
+	else
+	{
+		VertexDeduplication::deduplicate(mesh, vertices, indices);
+	}
+	computeBounds();
 
-	for (const auto& shape : shapes)
+	if (options.generateLods)
 	{
-		for (const auto& index : shape.mesh.indices)
+		generateLods();
+		if (options.report)
 		{
-			Vertex vertex{};
-
-			if (index.vertex_index >= 0)
+			*options.report << filepath << ": " << lods.size() << " LODs";
+			for (const Lod& lod : lods)
 			{
-				vertex.position = {
-					attribute.vertices[3 * index.vertex_index + 0],
-					attribute.vertices[3 * index.vertex_index + 1],
-					attribute.vertices[3 * index.vertex_index + 2]
-				};
-
-				vertex.color = {
-					attribute.colors[3 * index.vertex_index + 0],
-					attribute.colors[3 * index.vertex_index + 1],
-					attribute.colors[3 * index.vertex_index + 2]
-				};
+				*options.report << ", " << lod.indexCount / 3 << " triangles (error " << lod.error << ")";
 			}
+			*options.report << std::endl;
+		}
+	}
 
-			if (index.normal_index >= 0)
-			{
-				vertex.normal = {
-					attribute.normals[3 * index.normal_index + 0],
-					attribute.normals[3 * index.normal_index + 1],
-					attribute.normals[3 * index.normal_index + 2]
-				};
-			}
+	if (options.optimize)
+	{
+		if (options.report)
+		{
+			*options.report << filepath << ": ";
+		}
+		optimize(options.report);
+	}
 
-			if (index.texcoord_index >= 0)
-			{
-				vertex.uv = {
-					attribute.texcoords[2 * index.texcoord_index + 0],
-					attribute.texcoords[2 * index.texcoord_index + 1]
-				};
-			}
+	if (options.buildMeshlets)
+	{
+		buildMeshlets();
+		if (options.optimize)
+		{
+			// the meshlets changed which vertex each triangle reaches first
+			MeshOptimizer::optimizeVertexFetch(vertices, indices);
+		}
+		if (options.report)
+		{
+			// what is uploaded, optimize() measured the order before the meshlets
+			const Lod full = lods.empty() ? Lod{ 0, static_cast<uint32_t>(indices.size()), 0.0f } : lods[0];
+			const MeshOptimizer::CacheStats stats = MeshOptimizer::analyzeVertexCache(
+				std::span<const uint32_t>{ indices.data() + full.firstIndex, full.indexCount }, vertices.size());
+			*options.report << filepath << ": " << meshlets.size() << " meshlets, ACMR " << stats.acmr
+				<< ", ATVR " << stats.atvr << std::endl;
+		}
+	}
+
+	MeshCache::write(filepath, *this, MeshCache::flagsFor(options));
+}
+
+void Model::Builder::generateLods(uint32_t maxLodCount, float lodRatio, float maxError)
+{
+	if (indices.empty())
+	{
+		return;
+	}
+	if (lods.empty())
+	{
+		lods.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.0f });
+	}
+
+	// Every LOD is simplified from the full mesh, so its error is measured against the original.
+	const std::vector<uint32_t> fullIndices(indices.begin() + lods[0].firstIndex, indices.begin() + lods[0].firstIndex + lods[0].indexCount);
+	while (lods.size() < maxLodCount)
+	{
+		const size_t previousCount = lods.back().indexCount;
+		const size_t targetCount = static_cast<size_t>(previousCount * lodRatio) / 3 * 3;
+
+		float error = 0.0f;
+		std::vector<uint32_t> lodIndices = MeshSimplifier::simplify(vertices, fullIndices, targetCount, maxError, &error);
+		// stuck on locked topology or the error limit
+		if (lodIndices.empty() || lodIndices.size() > previousCount * 0.9f)
+		{
+			break;
+		}
+
+		lods.push_back({ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(lodIndices.size()), std::max(error, lods.back().error) });
+		indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+	}
+}
+
+void Model::Builder::optimize(std::ostream* report)
+{
+	if (indices.empty())
+	{
+		return;
+	}
+
+	const std::vector<Lod> ranges = lods.empty() ? std::vector<Lod>{ { 0, static_cast<uint32_t>(indices.size()), 0.0f } } : lods;
+	auto fullMesh = [&]()
+	{
+		return std::span<const uint32_t>{ indices.data() + ranges[0].firstIndex, ranges[0].indexCount };
+	};
+
+	const MeshOptimizer::CacheStats before = MeshOptimizer::analyzeVertexCache(fullMesh(), vertices.size());
+
+	// each LOD is drawn on its own, so each gets its own triangle order
+	for (const Lod& lod : ranges)
+	{
+		const auto first = indices.begin() + lod.firstIndex;
+		std::vector<uint32_t> lodIndices(first, first + lod.indexCount);
+		std::vector<uint32_t> clusterStarts;
+		MeshOptimizer::optimizeVertexCache(lodIndices, vertices.size(), &clusterStarts);
+		MeshOptimizer::optimizeOverdraw(lodIndices, vertices, clusterStarts);
+		std::copy(lodIndices.begin(), lodIndices.end(), first);
+	}
+	MeshOptimizer::optimizeVertexFetch(vertices, indices);
+
+	if (report)
+	{
+		const MeshOptimizer::CacheStats after = MeshOptimizer::analyzeVertexCache(fullMesh(), vertices.size());
+		*report << "ACMR " << before.acmr << " -> " << after.acmr
+			<< ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+	}
+}
 
-			if (uniqueVertices.count(vertex) == 0)
+void Model::Builder::buildMeshlets(uint32_t maxVertices, uint32_t maxTriangles)
+{
+	if (indices.empty())
+	{
+		return;
+	}
+
+	const Lod full = lods.empty() ? Lod{ 0, static_cast<uint32_t>(indices.size()), 0.0f } : lods[0];
+	const auto first = indices.begin() + full.firstIndex;
+	std::vector<uint32_t> fullIndices(first, first + full.indexCount);
+	meshlets = MeshletBuilder::build(fullIndices, vertices, maxVertices, maxTriangles);
+
+	// Growing the meshlets undoes the Tipsify order, so each one gets it back over its own few vertices.
+	std::vector<uint32_t> localOf(vertices.size(), ~0u);
+	std::vector<uint32_t> globalOf;
+	std::vector<uint32_t> localIndices;
+	for (Meshlet& meshlet : meshlets)
+	{
+		const auto meshletFirst = fullIndices.begin() + meshlet.firstIndex;
+		globalOf.clear();
+		localIndices.clear();
+		for (auto it = meshletFirst; it != meshletFirst + meshlet.indexCount; ++it)
+		{
+			if (localOf[*it] == ~0u)
 			{
-				uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-				vertices.push_back(vertex);
+				localOf[*it] = static_cast<uint32_t>(globalOf.size());
+				globalOf.push_back(*it);
 			}
-			indices.push_back(uniqueVertices[vertex]);
+			localIndices.push_back(localOf[*it]);
+		}
+		MeshOptimizer::optimizeVertexCache(localIndices, globalOf.size());
+		for (size_t i = 0; i < localIndices.size(); i++)
+		{
+			meshletFirst[i] = globalOf[localIndices[i]];
 		}
+		for (uint32_t vertex : globalOf)
+		{
+			localOf[vertex] = ~0u;
+		}
+
+		meshlet.firstIndex += full.firstIndex;
 	}
+	std::copy(fullIndices.begin(), fullIndices.end(), first);
+}
+
+void Model::Builder::computeBounds()
+{
+	bounds = Model::computeBounds(vertices);
+}
+
+Model::MeshData Model::Builder::getMeshData() const
+{
+	return { vertices, indices, lods, meshlets, bounds };
 }
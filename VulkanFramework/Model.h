@@ -1,13 +1,49 @@
 #pragma once
 
-#include "EngineDevice.h"
+#include "Bounds.h"
+#include "GeometryPool.h"
+#include "Meshlet.h"
+#include "ThreadPool.h"
 #include <memory>
+#include <ostream>
+#include <span>
 #include <vector>
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 
+enum class VertexFormat
+{
+	// Model::Vertex, 44 bytes of float32
+	Float,
+	// Model::PackedVertex, 20 bytes
+	Packed
+};
+
+// Declared outside Model so it can be a default argument of Model's own members.
+struct ModelLoadOptions
+{
+	// spreads parsing and deduplication over the pool when set
+	ThreadPool* threadPool = nullptr;
+	// reorders triangles and vertices for the vertex cache, overdraw and fetch locality
+	bool optimize = false;
+	// appends simplified levels of detail after the full mesh
+	bool generateLods = false;
+	// splits the full mesh into meshlets that can be culled on their own
+	bool buildMeshlets = false;
+	VertexFormat vertexFormat = VertexFormat::Float;
+	// statistics of the load are printed here when set
+	std::ostream* report = nullptr;
+};
+
+// Model space extent of a model's vertices.
+struct ModelBounds
+{
+	BoundingBox box{};
+	BoundingSphere sphere{};
+};
+
 class Model
 {
 public:
@@ -27,33 +63,154 @@ public:
 				normal == rhs.normal && uv == rhs.uv;
 		}
 	};
+	// Positions are unorm16 relative to the mesh bounds and are decoded by getDecodeMatrix(),
+	// normals are octahedral snorm16, colors unorm8 and uvs half floats.
+	struct PackedVertex
+	{
+		uint16_t position[4]{};
+		int16_t normal[2]{};
+		uint8_t color[4]{};
+		uint16_t uv[2]{};
+
+		static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
+		static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+	};
+	// Largest difference between the packed and float vertices of a model.
+	struct QuantizationError
+	{
+		float position = 0.0f;
+		float normalDegrees = 0.0f;
+		float color = 0.0f;
+		float uv = 0.0f;
+	};
+	// Range of the model's indices drawing one level of detail over the shared vertices.
+	// error is how far it strays from the full mesh, in model units.
+	struct Lod
+	{
+		uint32_t firstIndex = 0;
+		uint32_t indexCount = 0;
+		float error = 0.0f;
+	};
+	static constexpr uint32_t MAX_LOD_COUNT = 6;
+	using LoadOptions = ModelLoadOptions;
+	// Everything a Model uploads, viewed from a Builder or a mapped MeshCache.
+	struct MeshData
+	{
+		std::span<const Vertex> vertices{};
+		std::span<const uint32_t> indices{};
+		// without lods the whole index range is the only LOD
+		std::span<const Lod> lods{};
+		std::span<const Meshlet> meshlets{};
+		ModelBounds bounds{};
+	};
 	struct Builder
 	{
 		std::vector<Vertex> vertices{};
 		std::vector<uint32_t> indices{};
+		// full mesh first, then ever coarser ranges of indices; empty when indices is the only LOD
+		std::vector<Lod> lods{};
+		// clusters of the full mesh, each a contiguous range of its indices
+		std::vector<Meshlet> meshlets{};
+		// filled by loadModel; call computeBounds() after filling vertices by hand
+		ModelBounds bounds{};
 
-		void loadModel(const std::string& filepath);
+		// Reads the binary mesh cache when it is up to date, otherwise parses the file and writes the cache.
+		void loadModel(const std::string& filepath, const LoadOptions& options = {});
+		// loadModel without looking at the cache first, for callers that already found it stale.
+		void loadSource(const std::string& filepath, const LoadOptions& options = {});
+		// Appends simplified LODs, each aiming for lodRatio of the previous one's triangles, until
+		// maxLodCount is reached or simplifying further would stray more than maxError of the mesh extent.
+		void generateLods(uint32_t maxLodCount = MAX_LOD_COUNT, float lodRatio = 0.5f, float maxError = 0.05f);
+		// Runs the MeshOptimizer passes on every LOD, printing ACMR/ATVR of the full mesh before and after to report when given.
+		void optimize(std::ostream* report = nullptr);
+		// Reorders the full mesh's triangles into meshlets, then each meshlet's for the vertex cache.
+		// Run it after optimize(), which would reorder them again.
+		void buildMeshlets(uint32_t maxVertices = Meshlet::MAX_VERTICES, uint32_t maxTriangles = Meshlet::MAX_TRIANGLES);
+		void computeBounds();
+		MeshData getMeshData() const;
 	};
 public:
-	Model(EngineDevice& device, const Builder& builder);
+	Model(GeometryPool& geometryPool, const Builder& builder, VertexFormat vertexFormat = VertexFormat::Float);
+	// The pool's stride must match vertexFormat; packed models quantize the vertices on the way in.
+	// Meshlets go to the pool's meshlet buffer and stay on the CPU for culling, as do the bounds.
+	Model(GeometryPool& geometryPool, const MeshData& data, VertexFormat vertexFormat = VertexFormat::Float);
 	~Model();
 	Model(const Model&) = delete;
 	Model& operator=(const Model&) = delete;
 	
-	static std::unique_ptr<Model> createModelFromFile(EngineDevice& device, const std::string& filepath);
+	static std::unique_ptr<Model> createModelFromFile(GeometryPool& geometryPool, const std::string& filepath, const LoadOptions& options = {});
+	static VkDeviceSize vertexStride(VertexFormat vertexFormat);
+	// UINT16 whenever every index fits in 16 bits. Primitive restart is off, so 0xFFFF is a valid index.
+	static VkIndexType indexTypeFor(size_t vertexCount)
+	{
+		return vertexCount <= 65536 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+	}
+	// The box is exact; the sphere is Ritter's, or the box's circumsphere when that is tighter.
+	static ModelBounds computeBounds(std::span<const Vertex> vertices);
 	
+	GeometryPool& getGeometryPool() const
+	{
+		return geometryPool;
+	}
+	const GeometryPool::Range& getRange() const
+	{
+		return geometryPool.getRange(range);
+	}
+	UploadToken getUploadToken() const
+	{
+		return getRange().uploadToken;
+	}
+	VkIndexType getIndexType() const
+	{
+		return getRange().indexType;
+	}
+	VertexFormat getVertexFormat() const
+	{
+		return vertexFormat;
+	}
+	// Maps decoded vertex positions back to model space; fold it into the model matrix.
+	const glm::mat4& getDecodeMatrix() const
+	{
+		return decodeMatrix;
+	}
+	const QuantizationError& getQuantizationError() const
+	{
+		return quantizationError;
+	}
+	uint32_t getLodCount() const
+	{
+		return static_cast<uint32_t>(lods.size());
+	}
+	const Lod& getLod(uint32_t lod) const
+	{
+		return lods[lod];
+	}
+	// model space, unaffected by the decode matrix of packed models
+	const BoundingBox& getBoundingBox() const
+	{
+		return bounds.box;
+	}
+	const BoundingSphere& getBoundingSphere() const
+	{
+		return bounds.sphere;
+	}
+	// empty unless the model was built with meshlets; they cover LOD 0
+	std::span<const Meshlet> getMeshlets() const
+	{
+		return meshlets;
+	}
 	void bind(VkCommandBuffer commandBuffer);
-	void draw(VkCommandBuffer commandBuffer);
-private:
-	void createVertexBuffers(const std::vector<Vertex>& vertices);
-	void createIndexBuffers(const std::vector<uint32_t>& indices);
+	void bind(CommandRecorder& recorder);
+	void draw(VkCommandBuffer commandBuffer, uint32_t lod = 0, uint32_t instanceCount = 1, uint32_t firstInstance = 0);
+	// Draws meshlets [firstMeshlet, firstMeshlet + meshletCount) of LOD 0 in one call, they are contiguous.
+	void drawMeshlets(VkCommandBuffer commandBuffer, uint32_t firstMeshlet, uint32_t meshletCount, uint32_t firstInstance = 0);
 private:
-	EngineDevice& device;
-	VkBuffer vertexBuffer;
-	VkDeviceMemory vertexBufferMemory;
-	uint32_t vertexCount;
-	bool hasIndexBuffer = false;
-	VkBuffer indexBuffer;
-	VkDeviceMemory indexBufferMemory;
-	uint32_t indexCount;
+	GeometryPool& geometryPool;
+	GeometryPool::RangeId range;
+	VertexFormat vertexFormat;
+	glm::mat4 decodeMatrix{ 1.0f };
+	QuantizationError quantizationError{};
+	std::vector<Lod> lods;
+	std::vector<Meshlet> meshlets;
+	ModelBounds bounds;
 };
\ No newline at end of file
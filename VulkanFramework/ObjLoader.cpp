@@ -0,0 +1,717 @@
+#include "ObjLoader.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+	constexpr size_t MIN_CHUNK_SIZE = 256 * 1024;
+	constexpr size_t CHUNKS_PER_THREAD = 4;
+
+	enum Attribute
+	{
+		POSITION,
+		TEXCOORD,
+		NORMAL
+	};
+
+	struct Chunk
+	{
+		const char* begin = nullptr;
+		const char* end = nullptr;
+
+		std::vector<glm::vec3> positions{};
+		std::vector<glm::vec3> colors{};
+		std::vector<glm::vec3> normals{};
+		std::vector<glm::vec2> texcoords{};
+		std::vector<ObjLoader::Corner> faceCorners{};
+		std::vector<uint32_t> faceSizes{};
+		// faceCorners entries (corner * 3 + Attribute) holding a negative index, relative to the chunk
+		std::vector<uint32_t> relativeIndices{};
+		std::vector<ObjLoader::Corner> triangles{};
+
+		size_t lineCount = 0;
+		// 1-based line within the chunk of the first malformed face, 0 for none
+		size_t errorLine = 0;
+
+		size_t positionBase = 0;
+		size_t normalBase = 0;
+		size_t texcoordBase = 0;
+		size_t triangleBase = 0;
+		size_t lineBase = 0;
+	};
+
+	bool isSpace(char c)
+	{
+		return c == ' ' || c == '\t';
+	}
+
+	bool isDigit(char c)
+	{
+		return static_cast<unsigned int>(c - '0') < 10u;
+	}
+
+	const char* skipSpaces(const char* p, const char* end)
+	{
+		while (p < end && isSpace(*p))
+		{
+			p++;
+		}
+		return p;
+	}
+
+	// Tokens end at a space, tab or carriage return, like tinyobj's strcspn(token, " \t\r").
+	const char* findTokenEnd(const char* p, const char* end, bool stopAtSlash = false)
+	{
+		while (p < end && !isSpace(*p) && *p != '\r' && !(stopAtSlash && *p == '/'))
+		{
+			p++;
+		}
+		return p;
+	}
+
+	int32_t& attributeOf(ObjLoader::Corner& corner, int attribute)
+	{
+		switch (attribute)
+		{
+		case POSITION:
+			return corner.position;
+		case TEXCOORD:
+			return corner.texcoord;
+		default:
+			return corner.normal;
+		}
+	}
+
+	// Uses the same arithmetic as tinyobj's tryParseDouble rather than a correctly rounded
+	// conversion, so every float comes out bit identical to what tinyobj produced.
+	bool parseDouble(const char* s, const char* end, double& result)
+	{
+		if (s >= end)
+		{
+			return false;
+		}
+
+		double mantissa = 0.0;
+		int exponent = 0;
+		bool negative = false;
+		bool leadingDot = false;
+		const char* p = s;
+
+		if (*p == '+' || *p == '-')
+		{
+			negative = *p == '-';
+			p++;
+			leadingDot = p != end && *p == '.';
+		}
+		else if (*p == '.')
+		{
+			leadingDot = true;
+		}
+		else if (!isDigit(*p))
+		{
+			return false;
+		}
+
+		if (!leadingDot)
+		{
+			int digits = 0;
+			while (p != end && isDigit(*p))
+			{
+				mantissa = mantissa * 10 + static_cast<int>(*p - '0');
+				p++;
+				digits++;
+			}
+			if (digits == 0)
+			{
+				return false;
+			}
+		}
+
+		if (p != end && *p == '.')
+		{
+			static const double powers[] = { 1.0, 0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001 };
+			constexpr int powerCount = sizeof(powers) / sizeof(powers[0]);
+
+			p++;
+			for (int digit = 1; p != end && isDigit(*p); digit++, p++)
+			{
+				mantissa += static_cast<int>(*p - '0') * (digit < powerCount ? powers[digit] : std::pow(10.0, -digit));
+			}
+		}
+
+		if (p != end && (*p == 'e' || *p == 'E'))
+		{
+			p++;
+			bool negativeExponent = false;
+			if (p != end && (*p == '+' || *p == '-'))
+			{
+				negativeExponent = *p == '-';
+				p++;
+			}
+			else if (p == end || !isDigit(*p))
+			{
+				return false;
+			}
+
+			int digits = 0;
+			while (p != end && isDigit(*p))
+			{
+				if (exponent > std::numeric_limits<int>::max() / 10)
+				{
+					return false;
+				}
+				exponent = exponent * 10 + static_cast<int>(*p - '0');
+				p++;
+				digits++;
+			}
+			if (digits == 0)
+			{
+				return false;
+			}
+			if (negativeExponent)
+			{
+				exponent = -exponent;
+			}
+		}
+
+		result = (negative ? -1 : 1) * (exponent ? std::ldexp(mantissa * std::pow(5.0, exponent), exponent) : mantissa);
+		return true;
+	}
+
+	bool tryParseFloat(const char*& p, const char* end, float& value)
+	{
+		p = skipSpaces(p, end);
+		const char* tokenEnd = findTokenEnd(p, end);
+		double parsed;
+		const bool ok = parseDouble(p, tokenEnd, parsed);
+		if (ok)
+		{
+			value = static_cast<float>(parsed);
+		}
+		p = tokenEnd;
+		return ok;
+	}
+
+	float parseFloat(const char*& p, const char* end, float defaultValue = 0.0f)
+	{
+		float value = defaultValue;
+		tryParseFloat(p, end, value);
+		return value;
+	}
+
+	// atoi semantics: optional sign, then digits up to the first non digit, 0 when there are none.
+	int parseInt(const char* p, const char* end)
+	{
+		p = skipSpaces(p, end);
+		if (p < end && *p == '+')
+		{
+			p++;
+			if (p < end && *p == '-')
+			{
+				return 0;
+			}
+		}
+		int value = 0;
+		std::from_chars(p, end, value);
+		return value;
+	}
+
+	// Reads one index of a face corner (v, v/vt, v//vn or v/vt/vn). Negative indices count back
+	// from the attributes parsed so far; they are stored relative to the chunk and rebased later.
+	bool parseIndex(const char*& p, const char* end, Chunk& chunk, int attribute)
+	{
+		const int index = parseInt(p, end);
+		p = findTokenEnd(p, end, true);
+		if (index == 0)
+		{
+			return false;
+		}
+
+		ObjLoader::Corner& corner = chunk.faceCorners.back();
+		if (index > 0)
+		{
+			attributeOf(corner, attribute) = index - 1;
+			return true;
+		}
+
+		size_t count = attribute == POSITION ? chunk.positions.size() :
+			attribute == TEXCOORD ? chunk.texcoords.size() : chunk.normals.size();
+		attributeOf(corner, attribute) = static_cast<int32_t>(count) + index;
+		chunk.relativeIndices.push_back(static_cast<uint32_t>((chunk.faceCorners.size() - 1) * 3 + attribute));
+		return true;
+	}
+
+	bool parseCorner(const char*& p, const char* end, Chunk& chunk)
+	{
+		chunk.faceCorners.emplace_back();
+
+		if (!parseIndex(p, end, chunk, POSITION))
+		{
+			return false;
+		}
+		if (p >= end || *p != '/')
+		{
+			return true;
+		}
+		p++;
+
+		if (p < end && *p == '/')
+		{
+			p++;
+			return parseIndex(p, end, chunk, NORMAL);
+		}
+
+		if (!parseIndex(p, end, chunk, TEXCOORD))
+		{
+			return false;
+		}
+		if (p >= end || *p != '/')
+		{
+			return true;
+		}
+		p++;
+		return parseIndex(p, end, chunk, NORMAL);
+	}
+
+	// Returns false on a malformed face.
+	bool parseLine(const char* p, const char* end, Chunk& chunk)
+	{
+		p = skipSpaces(p, end);
+		if (p == end || *p == '#')
+		{
+			return true;
+		}
+
+		const char c0 = p[0];
+		const char c1 = p + 1 < end ? p[1] : '\0';
+		const char c2 = p + 2 < end ? p[2] : '\0';
+
+		if (c0 == 'v' && isSpace(c1))
+		{
+			p += 2;
+			glm::vec3 position;
+			position.x = parseFloat(p, end);
+			position.y = parseFloat(p, end);
+			position.z = parseFloat(p, end);
+
+			glm::vec3 color;
+			if (!tryParseFloat(p, end, color.r) || !tryParseFloat(p, end, color.g) || !tryParseFloat(p, end, color.b))
+			{
+				color = glm::vec3{ 1.0f };
+			}
+
+			chunk.positions.push_back(position);
+			chunk.colors.push_back(color);
+		}
+		else if (c0 == 'v' && c1 == 'n' && isSpace(c2))
+		{
+			p += 3;
+			glm::vec3 normal;
+			normal.x = parseFloat(p, end);
+			normal.y = parseFloat(p, end);
+			normal.z = parseFloat(p, end);
+			chunk.normals.push_back(normal);
+		}
+		else if (c0 == 'v' && c1 == 't' && isSpace(c2))
+		{
+			p += 3;
+			glm::vec2 texcoord;
+			texcoord.x = parseFloat(p, end);
+			texcoord.y = parseFloat(p, end);
+			chunk.texcoords.push_back(texcoord);
+		}
+		else if (c0 == 'f' && isSpace(c1))
+		{
+			p = skipSpaces(p + 2, end);
+			uint32_t size = 0;
+			while (p < end && *p != '\0')
+			{
+				if (!parseCorner(p, end, chunk))
+				{
+					return false;
+				}
+				size++;
+				while (p < end && (isSpace(*p) || *p == '\r'))
+				{
+					p++;
+				}
+			}
+			chunk.faceSizes.push_back(size);
+		}
+		return true;
+	}
+
+	void parseChunk(Chunk& chunk)
+	{
+		const char* p = chunk.begin;
+		while (p < chunk.end)
+		{
+			const char* lineEnd = p;
+			while (lineEnd < chunk.end && *lineEnd != '\n' && *lineEnd != '\r')
+			{
+				lineEnd++;
+			}
+
+			chunk.lineCount++;
+			if (!parseLine(p, lineEnd, chunk))
+			{
+				chunk.errorLine = chunk.lineCount;
+				return;
+			}
+
+			p = lineEnd;
+			if (p < chunk.end && *p == '\r')
+			{
+				p++;
+				if (p < chunk.end && *p == '\n')
+				{
+					p++;
+				}
+			}
+			else if (p < chunk.end)
+			{
+				p++;
+			}
+		}
+	}
+
+	// Point in polygon test from tinyobj (W. Randolph Franklin's pnpoly).
+	bool pointInTriangle(const float* x, const float* y, float testX, float testY)
+	{
+		bool inside = false;
+		for (int i = 0, j = 2; i < 3; j = i++)
+		{
+			if (((y[i] > testY) != (y[j] > testY)) &&
+				(testX < (x[j] - x[i]) * (testY - y[i]) / (y[j] - y[i]) + x[i]))
+			{
+				inside = !inside;
+			}
+		}
+		return inside;
+	}
+
+	// Splits one polygon into triangles exactly like tinyobj's built-in triangulation:
+	// quads along their shorter diagonal, larger polygons by ear clipping.
+	void triangulate(const ObjLoader::Corner* face, size_t size, const std::vector<glm::vec3>& positions,
+		std::vector<ObjLoader::Corner>& remaining, std::vector<ObjLoader::Corner>& triangles)
+	{
+		auto isValid = [&](const ObjLoader::Corner& corner)
+		{
+			return corner.position >= 0 && static_cast<size_t>(corner.position) < positions.size();
+		};
+
+		if (size < 3)
+		{
+			return;
+		}
+		if (size == 3)
+		{
+			triangles.insert(triangles.end(), face, face + 3);
+			return;
+		}
+		if (size == 4)
+		{
+			if (!isValid(face[0]) || !isValid(face[1]) || !isValid(face[2]) || !isValid(face[3]))
+			{
+				return;
+			}
+
+			const glm::vec3& v0 = positions[face[0].position];
+			const glm::vec3& v1 = positions[face[1].position];
+			const glm::vec3& v2 = positions[face[2].position];
+			const glm::vec3& v3 = positions[face[3].position];
+			const float e02x = v2.x - v0.x;
+			const float e02y = v2.y - v0.y;
+			const float e02z = v2.z - v0.z;
+			const float e13x = v3.x - v1.x;
+			const float e13y = v3.y - v1.y;
+			const float e13z = v3.z - v1.z;
+			const float sqr02 = e02x * e02x + e02y * e02y + e02z * e02z;
+			const float sqr13 = e13x * e13x + e13y * e13y + e13z * e13z;
+
+			if (sqr02 < sqr13)
+			{
+				triangles.insert(triangles.end(), { face[0], face[1], face[2], face[0], face[2], face[3] });
+			}
+			else
+			{
+				triangles.insert(triangles.end(), { face[0], face[1], face[3], face[1], face[2], face[3] });
+			}
+			return;
+		}
+
+		// project onto the plane of the first corner that isn't collinear
+		int axes[2] = { 1, 2 };
+		for (size_t k = 0; k < size; k++)
+		{
+			const ObjLoader::Corner& i0 = face[k];
+			const ObjLoader::Corner& i1 = face[(k + 1) % size];
+			const ObjLoader::Corner& i2 = face[(k + 2) % size];
+			if (!isValid(i0) || !isValid(i1) || !isValid(i2))
+			{
+				continue;
+			}
+
+			const glm::vec3& v0 = positions[i0.position];
+			const glm::vec3& v1 = positions[i1.position];
+			const glm::vec3& v2 = positions[i2.position];
+			const float e0x = v1.x - v0.x;
+			const float e0y = v1.y - v0.y;
+			const float e0z = v1.z - v0.z;
+			const float e1x = v2.x - v1.x;
+			const float e1y = v2.y - v1.y;
+			const float e1z = v2.z - v1.z;
+			const float cx = std::fabs(e0y * e1z - e0z * e1y);
+			const float cy = std::fabs(e0z * e1x - e0x * e1z);
+			const float cz = std::fabs(e0x * e1y - e0y * e1x);
+			const float epsilon = std::numeric_limits<float>::epsilon();
+			if (cx > epsilon || cy > epsilon || cz > epsilon)
+			{
+				if (!(cx > cy && cx > cz))
+				{
+					axes[0] = 0;
+					if (cz > cx && cz > cy)
+					{
+						axes[1] = 1;
+					}
+				}
+				break;
+			}
+		}
+
+		remaining.assign(face, face + size);
+		size_t guess = 0;
+		size_t remainingIterations = size;
+		size_t previousRemaining = size;
+
+		while (remaining.size() > 3 && remainingIterations > 0)
+		{
+			const size_t count = remaining.size();
+			if (guess >= count)
+			{
+				guess -= count;
+			}
+
+			if (previousRemaining != count)
+			{
+				previousRemaining = count;
+				remainingIterations = count;
+			}
+			else
+			{
+				remainingIterations--;
+			}
+
+			ObjLoader::Corner ear[3];
+			float x[3];
+			float y[3];
+			for (size_t k = 0; k < 3; k++)
+			{
+				ear[k] = remaining[(guess + k) % count];
+				x[k] = isValid(ear[k]) ? positions[ear[k].position][axes[0]] : 0.0f;
+				y[k] = isValid(ear[k]) ? positions[ear[k].position][axes[1]] : 0.0f;
+			}
+
+			const float e0x = x[1] - x[0];
+			const float e0y = y[1] - y[0];
+			const float e1x = x[2] - x[1];
+			const float e1y = y[2] - y[1];
+			const float cross = e0x * e1y - e0y * e1x;
+			const float area = (x[0] * y[1] - y[0] * x[1]) * 0.5f;
+			if (cross * area < 0.0f)
+			{
+				guess++;
+				continue;
+			}
+
+			bool overlap = false;
+			for (size_t other = 3; other < count && !overlap; other++)
+			{
+				const ObjLoader::Corner& corner = remaining[(guess + other) % count];
+				if (isValid(corner))
+				{
+					const glm::vec3& position = positions[corner.position];
+					overlap = pointInTriangle(x, y, position[axes[0]], position[axes[1]]);
+				}
+			}
+			if (overlap)
+			{
+				guess++;
+				continue;
+			}
+
+			triangles.insert(triangles.end(), { ear[0], ear[1], ear[2] });
+			remaining.erase(remaining.begin() + (guess + 1) % count);
+		}
+
+		if (remaining.size() == 3)
+		{
+			triangles.insert(triangles.end(), remaining.begin(), remaining.end());
+		}
+	}
+}
+
+ObjLoader::ObjLoader(ThreadPool* threadPool)
+	:
+	threadPool(threadPool)
+{
+}
+
+ObjLoader::Mesh ObjLoader::load(const std::string& filepath)
+{
+	MappedFile file{ filepath };
+	if (!file.isOpen())
+	{
+		std::error_code error;
+		if (std::filesystem::file_size(filepath, error) == 0 && !error)
+		{
+			return {};
+		}
+		throw std::runtime_error("Failed to open " + filepath);
+	}
+
+	auto run = [this](size_t count, const std::function<void(size_t)>& task)
+	{
+		if (threadPool)
+		{
+			threadPool->parallelFor(count, task);
+		}
+		else
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				task(i);
+			}
+		}
+	};
+
+	// Split on line boundaries. More chunks than threads evens out dense and sparse regions.
+	const char* data = file.getData();
+	const char* dataEnd = data + file.getSize();
+	const size_t threadCount = threadPool ? threadPool->getThreadCount() : 1;
+	const size_t chunkCount = std::max<size_t>(1,
+		std::min(threadCount * CHUNKS_PER_THREAD, file.getSize() / MIN_CHUNK_SIZE));
+
+	std::vector<Chunk> chunks;
+	chunks.reserve(chunkCount);
+	const char* chunkBegin = data;
+	for (size_t i = 1; i <= chunkCount && chunkBegin < dataEnd; i++)
+	{
+		const char* split = dataEnd;
+		if (i < chunkCount)
+		{
+			const char* target = std::max(chunkBegin, data + file.getSize() * i / chunkCount);
+			const void* newline = memchr(target, '\n', dataEnd - target);
+			split = newline ? static_cast<const char*>(newline) + 1 : dataEnd;
+		}
+		if (split > chunkBegin)
+		{
+			Chunk& chunk = chunks.emplace_back();
+			chunk.begin = chunkBegin;
+			chunk.end = split;
+			chunkBegin = split;
+		}
+	}
+
+	run(chunks.size(), [&](size_t i) { parseChunk(chunks[i]); });
+
+	size_t positionCount = 0;
+	size_t normalCount = 0;
+	size_t texcoordCount = 0;
+	size_t lineCount = 0;
+	for (auto& chunk : chunks)
+	{
+		if (chunk.errorLine != 0)
+		{
+			throw std::runtime_error("Failed to parse face in " + filepath +
+				" (line " + std::to_string(lineCount + chunk.errorLine) + ")");
+		}
+
+		chunk.positionBase = positionCount;
+		chunk.normalBase = normalCount;
+		chunk.texcoordBase = texcoordCount;
+		chunk.lineBase = lineCount;
+		positionCount += chunk.positions.size();
+		normalCount += chunk.normals.size();
+		texcoordCount += chunk.texcoords.size();
+		lineCount += chunk.lineCount;
+	}
+
+	Mesh mesh{};
+	mesh.positions.resize(positionCount);
+	mesh.colors.resize(positionCount);
+	mesh.normals.resize(normalCount);
+	mesh.texcoords.resize(texcoordCount);
+
+	run(chunks.size(), [&](size_t i)
+		{
+			Chunk& chunk = chunks[i];
+			std::copy(chunk.positions.begin(), chunk.positions.end(), mesh.positions.begin() + chunk.positionBase);
+			std::copy(chunk.colors.begin(), chunk.colors.end(), mesh.colors.begin() + chunk.positionBase);
+			std::copy(chunk.normals.begin(), chunk.normals.end(), mesh.normals.begin() + chunk.normalBase);
+			std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), mesh.texcoords.begin() + chunk.texcoordBase);
+
+			for (uint32_t relative : chunk.relativeIndices)
+			{
+				const int attribute = relative % 3;
+				const size_t base = attribute == POSITION ? chunk.positionBase :
+					attribute == TEXCOORD ? chunk.texcoordBase : chunk.normalBase;
+				attributeOf(chunk.faceCorners[relative / 3], attribute) += static_cast<int32_t>(base);
+			}
+			chunk.positions = {};
+			chunk.colors = {};
+			chunk.normals = {};
+			chunk.texcoords = {};
+		});
+
+	run(chunks.size(), [&](size_t i)
+		{
+			Chunk& chunk = chunks[i];
+			std::vector<Corner> remaining;
+			chunk.triangles.reserve(chunk.faceCorners.size());
+
+			const Corner* face = chunk.faceCorners.data();
+			for (uint32_t size : chunk.faceSizes)
+			{
+				triangulate(face, size, mesh.positions, remaining, chunk.triangles);
+				face += size;
+			}
+			chunk.faceCorners = {};
+		});
+
+	size_t cornerCount = 0;
+	for (auto& chunk : chunks)
+	{
+		chunk.triangleBase = cornerCount;
+		cornerCount += chunk.triangles.size();
+	}
+	mesh.corners.resize(cornerCount);
+
+	run(chunks.size(), [&](size_t i)
+		{
+			const Chunk& chunk = chunks[i];
+			Corner* out = mesh.corners.data() + chunk.triangleBase;
+			for (Corner corner : chunk.triangles)
+			{
+				if (corner.position >= static_cast<int32_t>(positionCount) ||
+					corner.normal >= static_cast<int32_t>(normalCount) ||
+					corner.texcoord >= static_cast<int32_t>(texcoordCount))
+				{
+					throw std::runtime_error("Face index out of range in " + filepath);
+				}
+				corner.position = std::max(corner.position, -1);
+				corner.normal = std::max(corner.normal, -1);
+				corner.texcoord = std::max(corner.texcoord, -1);
+				*out++ = corner;
+			}
+		});
+
+	return mesh;
+}
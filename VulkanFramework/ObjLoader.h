@@ -0,0 +1,42 @@
+#pragma once
+
+#include "ThreadPool.h"
+#include <string>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// Wavefront OBJ geometry parser. The mapped file is split into line aligned chunks
+// that are parsed and triangulated on the thread pool, then stitched together in file
+// order. Produces the same triangles and attribute values as tinyobj::LoadObj with
+// triangulation and default vertex colors. Only geometry is read; groups, materials,
+// lines and points are skipped.
+class ObjLoader
+{
+public:
+	struct Corner
+	{
+		int32_t position = -1;
+		int32_t normal = -1;
+		int32_t texcoord = -1;
+	};
+	struct Mesh
+	{
+		std::vector<glm::vec3> positions{};
+		// one per position, white when the file has none
+		std::vector<glm::vec3> colors{};
+		std::vector<glm::vec3> normals{};
+		std::vector<glm::vec2> texcoords{};
+		// three per triangle in file order, -1 marks a missing attribute
+		std::vector<Corner> corners{};
+	};
+public:
+	// Without a thread pool the file is parsed on the calling thread.
+	ObjLoader(ThreadPool* threadPool = nullptr);
+
+	Mesh load(const std::string& filepath);
+private:
+	ThreadPool* threadPool;
+};
@@ -11,16 +11,30 @@ Pipeline::Pipeline(EngineDevice& device, const std::string& vertFilePath, const
 	createGraphicsPipeline(vertFilePath, fragFilePath, pci);
 }
 
+Pipeline::Pipeline(EngineDevice& device, const std::string& compFilePath, VkPipelineLayout pipelineLayout)
+	:
+	device(device),
+	bindPoint(VK_PIPELINE_BIND_POINT_COMPUTE)
+{
+	createComputePipeline(compFilePath, pipelineLayout);
+}
+
 Pipeline::~Pipeline()
 {
 	vkDestroyShaderModule(device.device(), vertShaderModule, nullptr);
 	vkDestroyShaderModule(device.device(), fragShaderModule, nullptr);
-	vkDestroyPipeline(device.device(), graphicsPipeline, nullptr);
+	vkDestroyShaderModule(device.device(), compShaderModule, nullptr);
+	vkDestroyPipeline(device.device(), pipeline, nullptr);
 }
 
 void Pipeline::bind(VkCommandBuffer commandBuffer)
 {
-	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+	vkCmdBindPipeline(commandBuffer, bindPoint, pipeline);
+}
+
+void Pipeline::bind(CommandRecorder& recorder)
+{
+	recorder.bindPipeline(bindPoint, pipeline);
 }
 
 void Pipeline::defaultPipelineConfigInfo(PipelineConfigInfo& configInfo)
@@ -92,6 +106,9 @@ void Pipeline::defaultPipelineConfigInfo(PipelineConfigInfo& configInfo)
 	configInfo.dynamicStateInfo.pDynamicStates = configInfo.dynamicStateEnables.data();
 	configInfo.dynamicStateInfo.dynamicStateCount = static_cast<uint32_t>(configInfo.dynamicStateEnables.size());
 	configInfo.dynamicStateInfo.flags = 0;
+
+	configInfo.bindingDescriptions = Model::Vertex::getBindingDescriptions();
+	configInfo.attributeDescriptions = Model::Vertex::getAttributeDescriptions();
 }
 
 std::vector<char> Pipeline::readFile(const std::string& filePath)
@@ -142,8 +159,8 @@ void Pipeline::createGraphicsPipeline(const std::string& vertFilePath, const std
 	shaderStages[1].pNext = nullptr;
 	shaderStages[1].pSpecializationInfo = nullptr;
 
-	auto bindingDescriptions = Model::Vertex::getBindingDescriptions();
-	auto attributeDescriptions = Model::Vertex::getAttributeDescriptions();
+	auto& bindingDescriptions = configInfo.bindingDescriptions;
+	auto& attributeDescriptions = configInfo.attributeDescriptions;
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
@@ -177,12 +194,38 @@ void Pipeline::createGraphicsPipeline(const std::string& vertFilePath, const std
 		1,
 		&pipelineInfo,
 		nullptr,
-		&graphicsPipeline) != VK_SUCCESS)
+		&pipeline) != VK_SUCCESS)
 	{
 		throw std::runtime_error("Failed to create graphics pipeline");
 	}
 }
 
+void Pipeline::createComputePipeline(const std::string& compFilePath, VkPipelineLayout pipelineLayout)
+{
+	assert(pipelineLayout != VK_NULL_HANDLE && "Cannot create compute pipeline: no pipelineLayout provided");
+
+	auto compCode = readFile(compFilePath);
+	createShaderModule(compCode, &compShaderModule);
+
+	VkPipelineShaderStageCreateInfo shaderStage{};
+	shaderStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	shaderStage.module = compShaderModule;
+	shaderStage.pName = "main";
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = shaderStage;
+	pipelineInfo.layout = pipelineLayout;
+	pipelineInfo.basePipelineIndex = -1;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+	if (vkCreateComputePipelines(device.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create compute pipeline");
+	}
+}
+
 void Pipeline::createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule)
 {
 	VkShaderModuleCreateInfo createInfo{};
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "CommandRecorder.h"
 #include "EngineDevice.h"
 #include "Model.h"
 #include <string>
@@ -20,6 +21,8 @@ struct PipelineConfigInfo
 	VkPipelineDepthStencilStateCreateInfo depthStencilInfo;
 	std::vector<VkDynamicState> dynamicStateEnables;
 	VkPipelineDynamicStateCreateInfo dynamicStateInfo;
+	std::vector<VkVertexInputBindingDescription> bindingDescriptions{};
+	std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
 	VkPipelineLayout pipelineLayout = nullptr;
 	VkRenderPass renderPass = nullptr;
 	uint32_t subpass = 0;
@@ -29,19 +32,25 @@ class Pipeline
 {
 public:
 	Pipeline(EngineDevice& device, const std::string& vertFilePath, const std::string& fragFilePath, const PipelineConfigInfo& pci);
+	// a compute pipeline, bound to the compute bind point
+	Pipeline(EngineDevice& device, const std::string& compFilePath, VkPipelineLayout pipelineLayout);
 	Pipeline() = default;
 	~Pipeline();
 	Pipeline(const Pipeline&) = delete;
 	Pipeline& operator=(const Pipeline&) = delete;
 	void bind(VkCommandBuffer commandBuffer);
+	void bind(CommandRecorder& recorder);
 	static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo);
 private:
 	static std::vector<char> readFile(const std::string& filePath);
 	void createGraphicsPipeline(const std::string& vertFilePath, const std::string& fragFilePath, const PipelineConfigInfo& configInfo);
+	void createComputePipeline(const std::string& compFilePath, VkPipelineLayout pipelineLayout);
 	void createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule);
 private:
 	EngineDevice& device;
-	VkPipeline graphicsPipeline;
-	VkShaderModule vertShaderModule;
-	VkShaderModule fragShaderModule;
+	VkPipeline pipeline;
+	VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	VkShaderModule vertShaderModule = VK_NULL_HANDLE;
+	VkShaderModule fragShaderModule = VK_NULL_HANDLE;
+	VkShaderModule compShaderModule = VK_NULL_HANDLE;
 };
\ No newline at end of file
@@ -0,0 +1,104 @@
+#include "RangeAllocator.h"
+
+#include <cassert>
+#include <iterator>
+
+RangeAllocator::RangeAllocator(uint64_t size)
+	:
+	size(size)
+{
+	insertFreeRange(0, size);
+}
+
+bool RangeAllocator::allocate(uint64_t allocSize, uint64_t alignment, uint64_t& offset)
+{
+	// Smallest ranges first; the first one that still fits after alignment wins.
+	for (auto it = freeBySize.lower_bound(allocSize); it != freeBySize.end(); ++it)
+	{
+		const uint64_t rangeOffset = it->second;
+		const uint64_t rangeSize = it->first;
+		const uint64_t alignedOffset = (rangeOffset + alignment - 1) / alignment * alignment;
+
+		if (alignedOffset + allocSize > rangeOffset + rangeSize)
+		{
+			continue;
+		}
+
+		eraseFreeRange(freeByOffset.find(rangeOffset));
+
+		if (alignedOffset > rangeOffset)
+		{
+			insertFreeRange(rangeOffset, alignedOffset - rangeOffset);
+		}
+		const uint64_t tail = rangeOffset + rangeSize - (alignedOffset + allocSize);
+		if (tail > 0)
+		{
+			insertFreeRange(alignedOffset + allocSize, tail);
+		}
+
+		offset = alignedOffset;
+		used += allocSize;
+		allocationCount++;
+		return true;
+	}
+
+	return false;
+}
+
+void RangeAllocator::free(uint64_t offset, uint64_t freeSize)
+{
+	assert(allocationCount > 0 && "Freeing from an empty range allocator!");
+
+	used -= freeSize;
+	allocationCount--;
+
+	auto next = freeByOffset.lower_bound(offset);
+	if (next != freeByOffset.end() && next->first == offset + freeSize)
+	{
+		freeSize += next->second;
+		next = std::next(next);
+		eraseFreeRange(std::prev(next));
+	}
+	if (next != freeByOffset.begin())
+	{
+		auto prev = std::prev(next);
+		if (prev->first + prev->second == offset)
+		{
+			offset = prev->first;
+			freeSize += prev->second;
+			eraseFreeRange(prev);
+		}
+	}
+
+	insertFreeRange(offset, freeSize);
+}
+
+void RangeAllocator::reset(uint64_t newSize)
+{
+	size = newSize;
+	used = 0;
+	allocationCount = 0;
+	freeByOffset.clear();
+	freeBySize.clear();
+	insertFreeRange(0, size);
+}
+
+void RangeAllocator::insertFreeRange(uint64_t offset, uint64_t rangeSize)
+{
+	freeByOffset.emplace(offset, rangeSize);
+	freeBySize.emplace(rangeSize, offset);
+}
+
+void RangeAllocator::eraseFreeRange(std::map<uint64_t, uint64_t>::iterator it)
+{
+	auto [first, last] = freeBySize.equal_range(it->second);
+	for (auto sizeIt = first; sizeIt != last; ++sizeIt)
+	{
+		if (sizeIt->second == it->first)
+		{
+			freeBySize.erase(sizeIt);
+			break;
+		}
+	}
+	freeByOffset.erase(it);
+}
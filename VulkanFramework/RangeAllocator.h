@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+
+// Best-fit allocator over an abstract [0, size) range. Free ranges are indexed
+// both by offset (for coalescing) and by size (for lookup). Units are up to the
+// caller: bytes for device memory, elements for geometry.
+class RangeAllocator
+{
+public:
+	explicit RangeAllocator(uint64_t size);
+
+	bool allocate(uint64_t allocSize, uint64_t alignment, uint64_t& offset);
+	void free(uint64_t offset, uint64_t freeSize);
+	void reset(uint64_t newSize);
+
+	uint64_t getSize() const
+	{
+		return size;
+	}
+	uint64_t getUsed() const
+	{
+		return used;
+	}
+	uint32_t getAllocationCount() const
+	{
+		return allocationCount;
+	}
+	bool isEmpty() const
+	{
+		return allocationCount == 0;
+	}
+	uint64_t largestFreeRange() const
+	{
+		return freeBySize.empty() ? 0 : freeBySize.rbegin()->first;
+	}
+private:
+	void insertFreeRange(uint64_t offset, uint64_t rangeSize);
+	void eraseFreeRange(std::map<uint64_t, uint64_t>::iterator it);
+private:
+	uint64_t size;
+	uint64_t used = 0;
+	uint32_t allocationCount = 0;
+	std::map<uint64_t, uint64_t> freeByOffset;
+	std::multimap<uint64_t, uint64_t> freeBySize;
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Renderer.h"
+#include "UploadService.h"
 #include <stdexcept>
 #include <array>
 
@@ -16,6 +17,13 @@ Renderer::Renderer(Window& window, EngineDevice& device)
 Renderer::~Renderer()
 {
 	freeCommandBuffers();
+	for (std::vector<SecondaryCommandPool>& pools : secondaryPools)
+	{
+		for (SecondaryCommandPool& pool : pools)
+		{
+			vkDestroyCommandPool(device.device(), pool.commandPool, nullptr);
+		}
+	}
 }
 
 void Renderer::freeCommandBuffers()
@@ -90,6 +98,13 @@ VkCommandBuffer Renderer::beginFrame()
 
 	isFrameStarted = true;
 
+	// the frame's fence was waited on, so its secondary command buffers are free to record again
+	for (SecondaryCommandPool& pool : secondaryPools[currentFrameIndex])
+	{
+		vkResetCommandPool(device.device(), pool.commandPool, 0);
+		pool.usedCount = 0;
+	}
+
 	auto commandBuffer = getCurrentCommandBuffer();
 	VkCommandBufferBeginInfo beginInfo{};
 	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -99,6 +114,9 @@ VkCommandBuffer Renderer::beginFrame()
 		throw std::runtime_error("Failed to begin recording command buffer!");
 	}
 
+	// Geometry uploaded since the last frame becomes usable once this frame's submission waits for it.
+	uploadWaitValue = device.uploadService().acquireOnGraphics(commandBuffer);
+
 	return commandBuffer;
 };
 
@@ -113,7 +131,7 @@ void Renderer::endFrame()
 		throw std::runtime_error("Failed to record command buffer!");
 	}
 
-	auto result = engSwapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex);
+	auto result = engSwapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex, uploadWaitValue);
 
 	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR ||
 		window.wasWindowResized())
@@ -130,14 +148,14 @@ void Renderer::endFrame()
 	currentFrameIndex = (currentFrameIndex + 1) % EngineSwapChain::MAX_FRAMES_IN_FLIGHT;
 };
 
-void Renderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer)
+void Renderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer, SwapChainPass pass, VkSubpassContents contents)
 {
 	assert(isFrameStarted && "Cannot call beginSwapChainRenderPass while frame is not in progress!");
 	assert(commandBuffer == getCurrentCommandBuffer() && "Cannot begin render pass on command buffer from a different frame!");
 
 	VkRenderPassBeginInfo renderPassInfo{};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	renderPassInfo.renderPass = engSwapChain->getRenderPass();
+	renderPassInfo.renderPass = engSwapChain->getRenderPass(pass);
 	renderPassInfo.framebuffer = engSwapChain->getFrameBuffer(currentImageIndex);
 
 	renderPassInfo.renderArea.offset = { 0, 0 };
@@ -149,6 +167,93 @@ void Renderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer)
 	renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
 	renderPassInfo.pClearValues = clearValues.data();
 
+	setViewportAndScissor(commandBuffer);
+
+	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
+	currentPass = pass;
+	currentContents = contents;
+};
+
+void Renderer::endSwapChainRenderPass(VkCommandBuffer commandBuffer)
+{
+	assert(isFrameStarted && "Cannot call endSwapChainRenderPass while frame is not in progress!");
+	assert(commandBuffer == getCurrentCommandBuffer() && "Cannot end render pass on command buffer from a different frame!");
+
+	vkCmdEndRenderPass(commandBuffer);
+};
+
+void Renderer::recordSecondaryCommandBuffers(VkCommandBuffer commandBuffer, ThreadPool& threadPool, uint32_t sliceCount,
+	const std::function<void(VkCommandBuffer, uint32_t)>& recordSlice)
+{
+	assert(isFrameStarted && "Cannot record secondary command buffers while frame is not in progress!");
+	assert(currentContents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS && "Render pass was not begun for secondary command buffers!");
+
+	// pools and command buffers are created here, on the recording thread, so the slices only record
+	std::vector<SecondaryCommandPool>& pools = secondaryPools[currentFrameIndex];
+	while (pools.size() < sliceCount)
+	{
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = device.findPhysicalQueueFamilies().graphicsFamily;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		SecondaryCommandPool pool{};
+		if (vkCreateCommandPool(device.device(), &poolInfo, nullptr, &pool.commandPool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create secondary command pool!");
+		}
+		pools.push_back(std::move(pool));
+	}
+	secondaryCommandBuffers.resize(sliceCount);
+	for (uint32_t slice = 0; slice < sliceCount; slice++)
+	{
+		SecondaryCommandPool& pool = pools[slice];
+		if (pool.usedCount == pool.commandBuffers.size())
+		{
+			VkCommandBufferAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			allocInfo.commandPool = pool.commandPool;
+			allocInfo.commandBufferCount = 1;
+			VkCommandBuffer secondary;
+			if (vkAllocateCommandBuffers(device.device(), &allocInfo, &secondary) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to allocate secondary command buffer!");
+			}
+			pool.commandBuffers.push_back(secondary);
+		}
+		secondaryCommandBuffers[slice] = pool.commandBuffers[pool.usedCount++];
+	}
+
+	VkCommandBufferInheritanceInfo inheritanceInfo{};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.renderPass = engSwapChain->getRenderPass(currentPass);
+	inheritanceInfo.subpass = 0;
+	inheritanceInfo.framebuffer = engSwapChain->getFrameBuffer(currentImageIndex);
+
+	threadPool.parallelFor(sliceCount, [&](size_t slice)
+	{
+		VkCommandBuffer secondary = secondaryCommandBuffers[slice];
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+		beginInfo.pInheritanceInfo = &inheritanceInfo;
+		if (vkBeginCommandBuffer(secondary, &beginInfo) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to begin recording secondary command buffer!");
+		}
+		// dynamic state is not inherited from the primary
+		setViewportAndScissor(secondary);
+		recordSlice(secondary, static_cast<uint32_t>(slice));
+		if (vkEndCommandBuffer(secondary) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to record secondary command buffer!");
+		}
+	});
+	vkCmdExecuteCommands(commandBuffer, sliceCount, secondaryCommandBuffers.data());
+}
+
+void Renderer::setViewportAndScissor(VkCommandBuffer commandBuffer) const
+{
 	VkViewport viewport{};
 	viewport.x = 0.0f;
 	viewport.y = 0.0f;
@@ -159,14 +264,4 @@ void Renderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer)
 	VkRect2D scissor{ {0, 0}, engSwapChain->getSwapChainExtent() };
 	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
-
-	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-};
-
-void Renderer::endSwapChainRenderPass(VkCommandBuffer commandBuffer)
-{
-	assert(isFrameStarted && "Cannot call endSwapChainRenderPass while frame is not in progress!");
-	assert(commandBuffer == getCurrentCommandBuffer() && "Cannot end render pass on command buffer from a different frame!");
-
-	vkCmdEndRenderPass(commandBuffer);
-};
\ No newline at end of file
+}
\ No newline at end of file
@@ -3,6 +3,9 @@
 #include "Window.h"
 #include "EngineDevice.h"
 #include "EngineSwapChain.h"
+#include "ThreadPool.h"
+#include <array>
+#include <functional>
 #include <memory>
 #include <cassert>
 
@@ -27,6 +30,10 @@ public:
 	{
 		return engSwapChain->extentAspectRatio();
 	}
+	VkExtent2D getSwapChainExtent() const
+	{
+		return engSwapChain->getSwapChainExtent();
+	}
 	bool isFrameInProgress() const
 	{
 		return isFrameStarted;
@@ -36,6 +43,12 @@ public:
 		assert(isFrameStarted && "Cannot get command buffer when the frame is not in progress!");
 		return commandBuffers[currentFrameIndex];
 	}
+	// depth of the image being rendered, readable after a SwapChainPass::KeepDepth pass
+	VkImageView getDepthImageView() const
+	{
+		assert(isFrameStarted && "Cannot get depth image view when the frame is not in progress!");
+		return engSwapChain->getDepthImageView(currentImageIndex);
+	}
 	int getFrameIndex() const
 	{
 		assert(isFrameStarted && "Cannot get frame index when the frame is not in progress!");
@@ -44,18 +57,39 @@ public:
 
 	VkCommandBuffer beginFrame();
 	void endFrame();
-	void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
+	// With VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS the pass is recorded by recordSecondaryCommandBuffers.
+	void beginSwapChainRenderPass(VkCommandBuffer commandBuffer, SwapChainPass pass = SwapChainPass::Whole,
+		VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
 	void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
+	// Records recordSlice(secondary, slice) for every slice in [0, sliceCount) on the thread pool, each into its own
+	// secondary command buffer continuing the current render pass with the viewport and scissor set, and executes
+	// them in slice order. Every slice has a command pool per frame in flight, so no two threads share one.
+	void recordSecondaryCommandBuffers(VkCommandBuffer commandBuffer, ThreadPool& threadPool, uint32_t sliceCount,
+		const std::function<void(VkCommandBuffer, uint32_t)>& recordSlice);
+private:
+	// a slice's command pool in one frame and the secondary command buffers allocated from it
+	struct SecondaryCommandPool
+	{
+		VkCommandPool commandPool = VK_NULL_HANDLE;
+		std::vector<VkCommandBuffer> commandBuffers;
+		uint32_t usedCount = 0;
+	};
 private:
 	void createCommandBuffers();
 	void freeCommandBuffers();
 	void recreateSwapChain();
+	void setViewportAndScissor(VkCommandBuffer commandBuffer) const;
 private:
 	Window& window;
 	EngineDevice& device;
 	std::unique_ptr<EngineSwapChain> engSwapChain;
 	std::vector<VkCommandBuffer> commandBuffers;
+	std::array<std::vector<SecondaryCommandPool>, EngineSwapChain::MAX_FRAMES_IN_FLIGHT> secondaryPools;
+	std::vector<VkCommandBuffer> secondaryCommandBuffers;
+	SwapChainPass currentPass = SwapChainPass::Whole;
+	VkSubpassContents currentContents = VK_SUBPASS_CONTENTS_INLINE;
 	uint32_t currentImageIndex;
+	uint64_t uploadWaitValue = 0;
 	int currentFrameIndex{0};
 	bool isFrameStarted = false;
 };
\ No newline at end of file
@@ -7,10 +7,27 @@ layout(location = 3) in vec2 uv;
 
 layout(location = 0) out vec3 fragColor;
 
+layout(set = 0, binding = 0) uniform CameraUbo
+{
+	mat4 projectionView;
+} camera;
+
+// SimpleRenderSystem::ObjectData, normal matrix columns in xyz and the color in w
+struct ObjectData
+{
+	mat4 modelMatrix;
+	vec4 normalMatrixColor[3];
+	uint materialIndex;
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer ObjectBuffer
+{
+	ObjectData objects[];
+};
+
 layout(push_constant) uniform Push
 {
-	mat4 transform;
-	mat4 normalMatrix;
+	mat4 decodeMatrix;
 } push;
 
 const vec3 DIRECTION_TO_LIGHT = normalize(vec3(1.0f, -3.0f, -1.0f));
@@ -18,11 +35,14 @@ const float AMBIENT = 0.2f;
 
 void main()
 {
-	gl_Position = push.transform * vec4(position, 1.0f);
+	ObjectData object = objects[gl_InstanceIndex];
+	gl_Position = camera.projectionView * object.modelMatrix * push.decodeMatrix * vec4(position, 1.0f);
 
-	vec3 normalWorldSpace = normalize(mat3(push.normalMatrix) * normal);
+	mat3 normalMatrix = mat3(object.normalMatrixColor[0].xyz, object.normalMatrixColor[1].xyz, object.normalMatrixColor[2].xyz);
+	vec3 normalWorldSpace = normalize(normalMatrix * normal);
 
 	float lightIntensity = AMBIENT + max(dot(normalWorldSpace, DIRECTION_TO_LIGHT), 0);
 
-	fragColor = lightIntensity * color;
+	vec3 objectColor = vec3(object.normalMatrixColor[0].w, object.normalMatrixColor[1].w, object.normalMatrixColor[2].w);
+	fragColor = lightIntensity * color * objectColor;
 }
\ No newline at end of file
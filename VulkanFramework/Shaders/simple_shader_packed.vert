@@ -0,0 +1,58 @@
+#version 450
+
+// Model::PackedVertex. The unorm position is decoded by push.decodeMatrix.
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec2 octNormal;
+layout(location = 3) in vec2 uv;
+
+layout(location = 0) out vec3 fragColor;
+
+layout(set = 0, binding = 0) uniform CameraUbo
+{
+	mat4 projectionView;
+} camera;
+
+// SimpleRenderSystem::ObjectData, normal matrix columns in xyz and the color in w
+struct ObjectData
+{
+	mat4 modelMatrix;
+	vec4 normalMatrixColor[3];
+	uint materialIndex;
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer ObjectBuffer
+{
+	ObjectData objects[];
+};
+
+layout(push_constant) uniform Push
+{
+	mat4 decodeMatrix;
+} push;
+
+const vec3 DIRECTION_TO_LIGHT = normalize(vec3(1.0f, -3.0f, -1.0f));
+const float AMBIENT = 0.2f;
+
+vec3 decodeOctahedral(vec2 encoded)
+{
+	vec3 normal = vec3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+	float t = max(-normal.z, 0.0f);
+	normal.x += normal.x >= 0.0f ? -t : t;
+	normal.y += normal.y >= 0.0f ? -t : t;
+	return normalize(normal);
+}
+
+void main()
+{
+	ObjectData object = objects[gl_InstanceIndex];
+	gl_Position = camera.projectionView * object.modelMatrix * push.decodeMatrix * vec4(position, 1.0f);
+
+	mat3 normalMatrix = mat3(object.normalMatrixColor[0].xyz, object.normalMatrixColor[1].xyz, object.normalMatrixColor[2].xyz);
+	vec3 normalWorldSpace = normalize(normalMatrix * decodeOctahedral(octNormal));
+
+	float lightIntensity = AMBIENT + max(dot(normalWorldSpace, DIRECTION_TO_LIGHT), 0);
+
+	vec3 objectColor = vec3(object.normalMatrixColor[0].w, object.normalMatrixColor[1].w, object.normalMatrixColor[2].w);
+	fragColor = lightIntensity * color * objectColor;
+}
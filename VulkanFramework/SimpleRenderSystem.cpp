@@ -2,32 +2,106 @@
 
 #include "SimpleRenderSystem.h"
 #include <stdexcept>
+#include <algorithm>
 #include <array>
 
 SimpleRenderSystem::SimpleRenderSystem(EngineDevice& device, VkRenderPass renderPass)
 	:
-	device(device)
+	device(device),
+	indirectCount(device.optionalFeatures.drawIndirectCount)
 {
+	createFrameResources();
 	createPipelineLayout();
 	createPipeline(renderPass);
+	createCullPipeline();
 }
 
 SimpleRenderSystem::~SimpleRenderSystem()
 {
+	for (FrameResources& frame : frames)
+	{
+		device.destroyBuffer(frame.cameraBuffer, frame.cameraMemory);
+		if (frame.objectBuffer != VK_NULL_HANDLE)
+		{
+			device.destroyBuffer(frame.objectBuffer, frame.objectMemory);
+		}
+		if (frame.meshBuffer != VK_NULL_HANDLE)
+		{
+			device.destroyBuffer(frame.meshBuffer, frame.meshMemory);
+			device.destroyBuffer(frame.indirectBuffer, frame.indirectMemory);
+			device.destroyBuffer(frame.countBuffer, frame.countMemory);
+		}
+		device.destroyBuffer(frame.cullUniformBuffer, frame.cullUniformMemory);
+	}
+	if (visibilityBuffer != VK_NULL_HANDLE)
+	{
+		device.destroyBuffer(visibilityBuffer, visibilityMemory);
+	}
 	vkDestroyPipelineLayout(device.device(), pipelineLayout, nullptr);
+	vkDestroyPipelineLayout(device.device(), cullPipelineLayout, nullptr);
+}
+
+void SimpleRenderSystem::createFrameResources()
+{
+	frameSetLayout = DescriptorSetLayout::Builder(device)
+		.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+		.addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+		.build();
+	// objects, meshes, indirect commands, counts, parameters, depth pyramid and visibility
+	cullSetLayout = DescriptorSetLayout::Builder(device)
+		.addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+		.addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+		.addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+		.addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+		.addBinding(4, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+		.addBinding(5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+		.addBinding(6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+		.build();
+	descriptorPool = DescriptorPool::Builder(device)
+		.setMaxSets(EngineSwapChain::MAX_FRAMES_IN_FLIGHT * 2)
+		.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, EngineSwapChain::MAX_FRAMES_IN_FLIGHT * 2)
+		.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, EngineSwapChain::MAX_FRAMES_IN_FLIGHT * 6)
+		.addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, EngineSwapChain::MAX_FRAMES_IN_FLIGHT)
+		.build();
+
+	for (FrameResources& frame : frames)
+	{
+		device.createBuffer(
+			sizeof(CameraUbo),
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			frame.cameraBuffer,
+			frame.cameraMemory);
+		device.createBuffer(
+			sizeof(CullUbo),
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			frame.cullUniformBuffer,
+			frame.cullUniformMemory);
+		if (!descriptorPool->allocateDescriptor(frameSetLayout->getDescriptorSetLayout(), frame.descriptorSet))
+		{
+			throw std::runtime_error("Failed to allocate frame descriptor set!");
+		}
+		if (!descriptorPool->allocateDescriptor(cullSetLayout->getDescriptorSetLayout(), frame.cullSet))
+		{
+			throw std::runtime_error("Failed to allocate cull descriptor set!");
+		}
+		reserveObjects(frame, MIN_OBJECT_CAPACITY);
+	}
 }
 
 void SimpleRenderSystem::createPipelineLayout()
 {
 	VkPushConstantRange pushConstantRange{};
-	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 	pushConstantRange.offset = 0;
 	pushConstantRange.size = sizeof(SimplePushConstantData);
 
 	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
 	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = 0;
-	pipelineLayoutInfo.pSetLayouts = nullptr;
+	const VkDescriptorSetLayout setLayout = frameSetLayout->getDescriptorSetLayout();
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &setLayout;
 	pipelineLayoutInfo.pushConstantRangeCount = 1;
 	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
 
@@ -50,29 +124,663 @@ void SimpleRenderSystem::createPipeline(VkRenderPass renderPass)
 		"Shaders/simple_shader.vert.spv",
 		"Shaders/simple_shader.frag.spv",
 		pipelineConfig);
+
+	pipelineConfig.bindingDescriptions = Model::PackedVertex::getBindingDescriptions();
+	pipelineConfig.attributeDescriptions = Model::PackedVertex::getAttributeDescriptions();
+	packedPipeline = std::make_unique<Pipeline>(
+		device,
+		"Shaders/simple_shader_packed.vert.spv",
+		"Shaders/simple_shader.frag.spv",
+		pipelineConfig);
+}
+
+void SimpleRenderSystem::createCullPipeline()
+{
+	if (!supportsGpuCulling())
+	{
+		return;
+	}
+
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(CullPushConstantData);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	const VkDescriptorSetLayout setLayout = cullSetLayout->getDescriptorSetLayout();
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &setLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(device.device(), &pipelineLayoutInfo, nullptr, &cullPipelineLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create cull pipelineLayout!");
+	}
+	cullPipeline = std::make_unique<Pipeline>(device, "Shaders/cull.comp.spv", cullPipelineLayout);
+	if (supportsOcclusionCulling())
+	{
+		occlusionCullPipeline = std::make_unique<Pipeline>(device, "Shaders/cull_occlusion.comp.spv", cullPipelineLayout);
+	}
+}
+
+bool SimpleRenderSystem::supportsGpuCulling() const
+{
+	// every object is drawn as its own instance index, and a batch is many draws in one call
+	return device.optionalFeatures.multiDrawIndirect && device.optionalFeatures.drawIndirectFirstInstance;
+}
+
+bool SimpleRenderSystem::supportsOcclusionCulling() const
+{
+	// the depth pyramid is an rg32f storage image
+	return supportsGpuCulling() && device.optionalFeatures.shaderStorageImageExtendedFormats;
+}
+
+void SimpleRenderSystem::renderEntities(VkCommandBuffer commandBuffer, int frameIndex, EntityStore& entities, const Camera& camera,
+	float viewportHeight)
+{
+	const uint32_t drawCount = prepareEntities(frameIndex, entities, camera, viewportHeight);
+	commandStats = recordDraws(commandBuffer, frameIndex, entities, 0, drawCount);
+}
+
+uint32_t SimpleRenderSystem::prepareEntities(int frameIndex, EntityStore& entities, const Camera& camera, float viewportHeight)
+{
+	projectionView = camera.getProjectionMatrix() * camera.getViewMatrix();
+	inverseView = glm::inverse(camera.getViewMatrix());
+
+	const std::span<const glm::mat4> worldMatrices = entities.getWorldMatrices();
+	const std::span<const glm::mat3> worldNormalMatrices = entities.getWorldNormalMatrices();
+	const std::span<const EntityStore::ModelHandle> models = entities.getModels();
+	const std::span<const glm::vec3> colors = entities.getColors();
+	const std::span<const uint32_t> materials = entities.getMaterials();
+	const std::span<uint32_t> lods = entities.getLods();
+
+	// only entities with a model crossing the view frustum are recorded
+	objectCuller.clear();
+	objectCuller.reserve(entities.size());
+	drawableObjects.clear();
+	for (uint32_t i = 0; i < entities.size(); i++)
+	{
+		if (models[i] == EntityStore::NO_MODEL)
+		{
+			continue;
+		}
+		const glm::mat4& objectMatrix = worldMatrices[i];
+		const Model& model = entities.getModel(models[i]);
+		objectCuller.add(model.getBoundingSphere().transformed(objectMatrix), model.getBoundingBox().transformed(objectMatrix));
+		drawableObjects.push_back(i);
+	}
+	objectCuller.cull(camera.getFrustum(), visibleObjects);
+
+	drawList.clear();
+	drawList.reserve(visibleObjects.size());
+	drawRuns.clear();
+	const glm::mat4& view = camera.getViewMatrix();
+	for (uint32_t visible : visibleObjects)
+	{
+		const uint32_t i = drawableObjects[visible];
+		const Model& model = entities.getModel(models[i]);
+		const BoundingSphere worldSphere = model.getBoundingSphere().transformed(worldMatrices[i]);
+		lods[i] = selectLod(model, worldSphere, lods[i], camera, viewportHeight);
+		// everything is opaque for now
+		const float viewDepth = glm::dot(glm::vec3(view[0][2], view[1][2], view[2][2]), worldSphere.center) + view[3][2];
+		const uint32_t modelPipeline = pipelineFor(model) == packedPipeline.get() ? 1 : 0;
+		drawList.add(DrawList::makeKey(DrawList::Pass::Opaque, modelPipeline, models[i], lods[i], materials[i], viewDepth), i);
+	}
+	if (drawList.empty())
+	{
+		drawStats = {};
+		unsortedDrawStats = {};
+		return 0;
+	}
+	unsortedDrawStats = countStateChanges(entities);
+	drawList.sort();
+	drawStats = countStateChanges(entities);
+
+	// object data in draw order, so every run's instances are contiguous from its firstInstance
+	FrameResources& frame = frames[frameIndex];
+	reserveObjects(frame, static_cast<uint32_t>(drawList.size()));
+	ObjectData* objects = static_cast<ObjectData*>(frame.objectMemory.mappedData);
+	for (size_t k = 0; k < drawList.size(); k++)
+	{
+		const uint32_t i = drawList.getItem(k);
+		const glm::mat3& normalMatrix = worldNormalMatrices[i];
+		objects[k].modelMatrix = worldMatrices[i];
+		objects[k].normalMatrixColor[0] = glm::vec4(normalMatrix[0], colors[i].r);
+		objects[k].normalMatrixColor[1] = glm::vec4(normalMatrix[1], colors[i].g);
+		objects[k].normalMatrixColor[2] = glm::vec4(normalMatrix[2], colors[i].b);
+		objects[k].materialIndex = materials[i];
+	}
+	static_cast<CameraUbo*>(frame.cameraMemory.mappedData)->projectionView = projectionView;
+
+	// every run of equal models and LODs is one instanced draw
+	for (uint32_t k = 0; k < drawList.size(); k++)
+	{
+		if (k == 0 || !DrawList::sameDraw(drawList.getKey(k - 1), drawList.getKey(k)))
+		{
+			drawRuns.push_back(k);
+		}
+	}
+	drawRuns.push_back(static_cast<uint32_t>(drawList.size()));
+	return static_cast<uint32_t>(drawRuns.size() - 1);
 }
 
-void SimpleRenderSystem::renderGameObjects(VkCommandBuffer commandBuffer, std::vector<GameObject>& gameObjects, const Camera& camera)
+CommandRecorder::Stats SimpleRenderSystem::recordDraws(VkCommandBuffer commandBuffer, int frameIndex, const EntityStore& entities,
+	uint32_t firstDraw, uint32_t drawCount) const
 {
-	pipeline->bind(commandBuffer);
+	if (drawCount == 0)
+	{
+		return {};
+	}
+	const std::span<const glm::mat4> worldMatrices = entities.getWorldMatrices();
+
+	// Models sharing a geometry pool share its buffers and models with the same decode matrix its push,
+	// so the recorder drops most of the binds.
+	CommandRecorder recorder(commandBuffer);
+	recorder.bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &frames[frameIndex].descriptorSet);
+	for (uint32_t draw = firstDraw; draw < firstDraw + drawCount; draw++)
+	{
+		const uint32_t first = drawRuns[draw];
+		const uint32_t last = drawRuns[draw + 1];
+		const uint64_t key = drawList.getKey(first);
 
-	auto projectionView = camera.getProjectionMatrix() * camera.getViewMatrix();
+		Model& model = entities.getModel(DrawList::getModel(key));
+		recordModelState(recorder, model);
 
-	for (auto& obj : gameObjects)
+		// meshlets are culled in one model's space, so only lone instances use them
+		const uint32_t lod = DrawList::getLod(key);
+		if (last - first == 1 && lod == 0 && !model.getMeshlets().empty())
+		{
+			const glm::mat4& objectMatrix = worldMatrices[drawList.getItem(first)];
+			drawVisibleMeshlets(commandBuffer, model, projectionView * objectMatrix, inverseView, objectMatrix, first);
+		}
+		else
+		{
+			model.draw(commandBuffer, lod, last - first, first);
+		}
+	}
+	return recorder.getStats();
+}
+
+DrawList::Stats SimpleRenderSystem::countStateChanges(const EntityStore& entities) const
+{
+	// renderEntities' binds over the draw list in its current order, recorded nowhere
+	CommandRecorder recorder(VK_NULL_HANDLE);
+	DrawList::Stats stats{};
+	for (size_t k = 0; k < drawList.size(); k++)
 	{
-		SimplePushConstantData push{};
-		auto modelMatrix = obj.transform.mat4();
-		push.transform = projectionView * modelMatrix;
-		push.normalMatrix = obj.transform.normalMatrix();
+		const uint64_t key = drawList.getKey(k);
+		if (k > 0 && DrawList::sameDraw(drawList.getKey(k - 1), key))
+		{
+			continue;
+		}
+		stats.draws++;
+		recordModelState(recorder, entities.getModel(DrawList::getModel(key)));
+	}
+	const CommandRecorder::Stats& commands = recorder.getStats();
+	stats.pipelineBinds = commands.pipelines.emitted;
+	stats.geometryBinds = commands.indexBuffers.emitted;
+	stats.pushConstants = commands.pushConstants.emitted;
+	return stats;
+}
 
-		vkCmdPushConstants(
-			commandBuffer,
-			pipelineLayout,
-			VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-			0,
-			sizeof(SimplePushConstantData),
-			&push);
-		obj.model->bind(commandBuffer);
-		obj.model->draw(commandBuffer);
+void SimpleRenderSystem::recordModelState(CommandRecorder& recorder, Model& model) const
+{
+	pipelineFor(model)->bind(recorder);
+	model.bind(recorder);
+	// packed positions are decoded before the model matrix applies
+	SimplePushConstantData push{};
+	push.decodeMatrix = model.getDecodeMatrix();
+	recorder.pushConstants(pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(SimplePushConstantData), &push);
+}
+
+void SimpleRenderSystem::cullEntitiesOnGpu(VkCommandBuffer commandBuffer, int frameIndex, EntityStore& entities, const Camera& camera,
+	VkExtent2D viewportExtent)
+{
+	assert(cullPipeline && "Device does not support GPU culling!");
+
+	const std::span<const glm::mat4> worldMatrices = entities.getWorldMatrices();
+	const std::span<const glm::mat3> worldNormalMatrices = entities.getWorldNormalMatrices();
+	const std::span<const EntityStore::ModelHandle> models = entities.getModels();
+	const std::span<const glm::vec3> colors = entities.getColors();
+	const std::span<const uint32_t> materials = entities.getMaterials();
+
+	// Objects are the entities in dense order, so an entity keeps its visibility from frame to frame unless a
+	// destroy moves it. Each model drawn gets a mesh, entities the GPU path doesn't draw have none.
+	FrameResources& frame = frames[frameIndex];
+	frame.batches.clear();
+	const uint32_t objectCount = entities.size();
+	if (objectCount == 0)
+	{
+		return;
+	}
+	reserveObjects(frame, objectCount);
+	reserveVisibility(commandBuffer, objectCount);
+	ObjectData* objects = static_cast<ObjectData*>(frame.objectMemory.mappedData);
+	meshOfModel.assign(entities.getModelCount(), NO_MESH);
+	meshObjectCounts.clear();
+	meshModels.clear();
+	uint32_t drawableCount = 0;
+	for (uint32_t i = 0; i < objectCount; i++)
+	{
+		objects[i].meshIndex = NO_MESH;
+		if (models[i] == EntityStore::NO_MODEL)
+		{
+			continue;
+		}
+		Model& model = entities.getModel(models[i]);
+		// indirect commands are indexed draws
+		if (model.getRange().indexCount == 0)
+		{
+			continue;
+		}
+		uint32_t& mesh = meshOfModel[models[i]];
+		if (mesh == NO_MESH)
+		{
+			mesh = static_cast<uint32_t>(meshModels.size());
+			meshModels.push_back(&model);
+			meshObjectCounts.push_back(0);
+		}
+		meshObjectCounts[mesh]++;
+		drawableCount++;
+
+		const glm::mat3& normalMatrix = worldNormalMatrices[i];
+		ObjectData& object = objects[i];
+		object.modelMatrix = worldMatrices[i];
+		object.normalMatrixColor[0] = glm::vec4(normalMatrix[0], colors[i].r);
+		object.normalMatrixColor[1] = glm::vec4(normalMatrix[1], colors[i].g);
+		object.normalMatrixColor[2] = glm::vec4(normalMatrix[2], colors[i].b);
+		object.materialIndex = materials[i];
+		object.meshIndex = mesh;
+	}
+	if (drawableCount == 0)
+	{
+		return;
+	}
+
+	// there are never more batches than meshes
+	const uint32_t meshCount = static_cast<uint32_t>(meshModels.size());
+	const uint32_t phaseCount = occlusionCulling ? OCCLUSION_PHASE_COUNT : 1;
+	reserveCullBuffers(frame, meshCount, drawableCount * phaseCount, meshCount * phaseCount);
+	GpuMesh* meshes = static_cast<GpuMesh*>(frame.meshMemory.mappedData);
+	meshBatches.resize(meshCount);
+	for (uint32_t m = 0; m < meshCount; m++)
+	{
+		Model& model = *meshModels[m];
+		auto sharesBatch = [&](const IndirectBatch& batch)
+		{
+			return batch.model->getVertexFormat() == model.getVertexFormat() && &batch.model->getGeometryPool() == &model.getGeometryPool() &&
+				batch.model->getIndexType() == model.getIndexType() && (model.getVertexFormat() == VertexFormat::Float || batch.model == &model);
+		};
+		auto batch = std::find_if(frame.batches.begin(), frame.batches.end(), sharesBatch);
+		if (batch == frame.batches.end())
+		{
+			frame.batches.push_back({ &model, 0, 0 });
+			batch = frame.batches.end() - 1;
+		}
+		batch->commandCount += meshObjectCounts[m];
+		meshBatches[m] = static_cast<uint32_t>(batch - frame.batches.begin());
+	}
+	// every batch gets room for all of its objects' draws
+	for (uint32_t b = 0, commandBase = 0; b < frame.batches.size(); b++)
+	{
+		frame.batches[b].commandBase = commandBase;
+		commandBase += frame.batches[b].commandCount;
+	}
+	for (uint32_t m = 0; m < meshCount; m++)
+	{
+		const Model& model = *meshModels[m];
+		const GeometryPool::Range& range = model.getRange();
+		GpuMesh mesh{};
+		mesh.boundingSphere = glm::vec4(model.getBoundingSphere().center, model.getBoundingSphere().radius);
+		mesh.lodCount = model.getLodCount();
+		mesh.vertexOffset = range.vertexOffset();
+		mesh.batch = meshBatches[m];
+		mesh.commandBase = frame.batches[meshBatches[m]].commandBase;
+		for (uint32_t lod = 0; lod < model.getLodCount(); lod++)
+		{
+			mesh.lods[lod] = { range.firstIndex + model.getLod(lod).firstIndex, model.getLod(lod).indexCount, model.getLod(lod).error, 0 };
+		}
+		meshes[m] = mesh;
+	}
+
+	// the pyramid follows the depth buffer's size; frames in flight may still read the old one
+	if (occlusionCulling && (!depthPyramid || depthPyramid->getDepthExtent().width != viewportExtent.width ||
+		depthPyramid->getDepthExtent().height != viewportExtent.height))
+	{
+		vkDeviceWaitIdle(device.device());
+		depthPyramid = std::make_unique<DepthPyramid>(device, viewportExtent);
+		for (FrameResources& other : frames)
+		{
+			other.cullSetStale = true;
+		}
+	}
+	if (frame.cullSetStale)
+	{
+		const VkDescriptorBufferInfo objectInfo{ frame.objectBuffer, 0, VK_WHOLE_SIZE };
+		const VkDescriptorBufferInfo meshInfo{ frame.meshBuffer, 0, VK_WHOLE_SIZE };
+		const VkDescriptorBufferInfo indirectInfo{ frame.indirectBuffer, 0, VK_WHOLE_SIZE };
+		const VkDescriptorBufferInfo countInfo{ frame.countBuffer, 0, VK_WHOLE_SIZE };
+		const VkDescriptorBufferInfo cullInfo{ frame.cullUniformBuffer, 0, sizeof(CullUbo) };
+		const VkDescriptorBufferInfo visibilityInfo{ visibilityBuffer, 0, VK_WHOLE_SIZE };
+		DescriptorWriter writer(*cullSetLayout, *descriptorPool);
+		writer.writeBuffer(0, &objectInfo)
+			.writeBuffer(1, &meshInfo)
+			.writeBuffer(2, &indirectInfo)
+			.writeBuffer(3, &countInfo)
+			.writeBuffer(4, &cullInfo)
+			.writeBuffer(6, &visibilityInfo);
+		// only the occlusion phase reads the pyramid
+		const VkDescriptorImageInfo pyramidInfo = depthPyramid ? depthPyramid->getDescriptorInfo() : VkDescriptorImageInfo{};
+		if (depthPyramid)
+		{
+			writer.writeImage(5, &pyramidInfo);
+		}
+		writer.overwrite(frame.cullSet);
+		frame.cullSetStale = false;
+	}
+
+	const uint32_t batchCount = static_cast<uint32_t>(frame.batches.size());
+	frame.commandsPerPhase = drawableCount;
+	const glm::mat4& projection = camera.getProjectionMatrix();
+	const Frustum frustum = camera.getFrustum();
+	CullUbo& cull = *static_cast<CullUbo*>(frame.cullUniformMemory.mappedData);
+	cull.projectionView = projection * camera.getViewMatrix();
+	std::copy(std::begin(frustum.planes), std::end(frustum.planes), cull.frustumPlanes);
+	cull.cameraPosition = glm::vec4(glm::vec3(glm::inverse(camera.getViewMatrix())[3]), projection[2][3] != 0.0f ? 1.0f : 0.0f);
+	cull.projectionScale = std::abs(projection[1][1]) * 0.5f * static_cast<float>(viewportExtent.height);
+	cull.errorThreshold = lodSettings.errorThreshold;
+	cull.objectCount = objectCount;
+	cull.occlusion = occlusionCulling;
+	cull.commandsPerPhase = frame.commandsPerPhase;
+	cull.batchCount = batchCount;
+
+	// Without draw counts every batch draws its whole range, so the commands nothing was
+	// appended to must be empty draws.
+	vkCmdFillBuffer(commandBuffer, frame.countBuffer, 0, phaseCount * batchCount * sizeof(uint32_t), 0);
+	if (!indirectCount)
+	{
+		vkCmdFillBuffer(commandBuffer, frame.indirectBuffer, 0, phaseCount * drawableCount * sizeof(VkDrawIndexedIndirectCommand), 0);
+	}
+	// the last frame's occlusion phase wrote the visibility read now
+	VkMemoryBarrier clearBarrier{};
+	clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+	cullPipeline->bind(commandBuffer);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, 0, 1, &frame.cullSet, 0, nullptr);
+	vkCmdDispatch(commandBuffer, (objectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+	VkMemoryBarrier cullBarrier{};
+	cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &cullBarrier, 0, nullptr, 0, nullptr);
+}
+
+void SimpleRenderSystem::cullOccludedEntitiesOnGpu(VkCommandBuffer commandBuffer, int frameIndex, VkImageView depthView)
+{
+	assert(occlusionCulling && "Occlusion culling is not enabled!");
+
+	FrameResources& frame = frames[frameIndex];
+	if (frame.batches.empty())
+	{
+		return;
+	}
+	depthPyramid->build(commandBuffer, frameIndex, depthView);
+
+	CullPushConstantData push{};
+	push.depthSize = glm::vec2(depthPyramid->getDepthExtent().width, depthPyramid->getDepthExtent().height);
+	push.pyramidLevelCount = depthPyramid->getLevelCount();
+
+	occlusionCullPipeline->bind(commandBuffer);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, 0, 1, &frame.cullSet, 0, nullptr);
+	vkCmdPushConstants(commandBuffer, cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstantData), &push);
+	const uint32_t objectCount = static_cast<const CullUbo*>(frame.cullUniformMemory.mappedData)->objectCount;
+	vkCmdDispatch(commandBuffer, (objectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+	VkMemoryBarrier cullBarrier{};
+	cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0,
+		1, &cullBarrier, 0, nullptr, 0, nullptr);
+}
+
+void SimpleRenderSystem::renderCulledEntities(VkCommandBuffer commandBuffer, int frameIndex, uint32_t phase)
+{
+	FrameResources& frame = frames[frameIndex];
+	if (frame.batches.empty())
+	{
+		return;
+	}
+	CommandRecorder recorder(commandBuffer);
+	recorder.bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &frame.descriptorSet);
+	for (uint32_t b = 0; b < frame.batches.size(); b++)
+	{
+		const IndirectBatch& batch = frame.batches[b];
+		recordModelState(recorder, *batch.model);
+
+		const VkDeviceSize offset = (phase * frame.commandsPerPhase + batch.commandBase) * sizeof(VkDrawIndexedIndirectCommand);
+		if (indirectCount)
+		{
+			const VkDeviceSize countOffset = (phase * frame.batches.size() + b) * sizeof(uint32_t);
+			vkCmdDrawIndexedIndirectCount(commandBuffer, frame.indirectBuffer, offset, frame.countBuffer, countOffset,
+				batch.commandCount, sizeof(VkDrawIndexedIndirectCommand));
+		}
+		else
+		{
+			vkCmdDrawIndexedIndirect(commandBuffer, frame.indirectBuffer, offset, batch.commandCount, sizeof(VkDrawIndexedIndirectCommand));
+		}
+	}
+	commandStats = recorder.getStats();
+}
+
+void SimpleRenderSystem::reserveObjects(FrameResources& frame, uint32_t count)
+{
+	if (count <= frame.objectCapacity)
+	{
+		return;
+	}
+
+	// the fence of this frame was waited on, so the GPU is done with its old buffer
+	if (frame.objectBuffer != VK_NULL_HANDLE)
+	{
+		device.destroyBuffer(frame.objectBuffer, frame.objectMemory);
+	}
+	frame.objectCapacity = std::max(MIN_OBJECT_CAPACITY, frame.objectCapacity * 2);
+	while (frame.objectCapacity < count)
+	{
+		frame.objectCapacity *= 2;
+	}
+	device.createBuffer(
+		frame.objectCapacity * sizeof(ObjectData),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		frame.objectBuffer,
+		frame.objectMemory);
+
+	const VkDescriptorBufferInfo cameraInfo{ frame.cameraBuffer, 0, sizeof(CameraUbo) };
+	const VkDescriptorBufferInfo objectInfo{ frame.objectBuffer, 0, VK_WHOLE_SIZE };
+	DescriptorWriter(*frameSetLayout, *descriptorPool)
+		.writeBuffer(0, &cameraInfo)
+		.writeBuffer(1, &objectInfo)
+		.overwrite(frame.descriptorSet);
+	frame.cullSetStale = true;
+}
+
+void SimpleRenderSystem::reserveCullBuffers(FrameResources& frame, uint32_t meshCount, uint32_t commandCount, uint32_t batchCount)
+{
+	// like reserveObjects, the frame's fence was waited on before its buffers are replaced
+	auto reserve = [&](VkBuffer& buffer, MemoryAllocation& memory, uint32_t& capacity, uint32_t count, VkDeviceSize elementSize,
+		VkBufferUsageFlags usage, VkMemoryPropertyFlags properties)
+	{
+		if (count <= capacity)
+		{
+			return;
+		}
+		if (buffer != VK_NULL_HANDLE)
+		{
+			device.destroyBuffer(buffer, memory);
+		}
+		capacity = std::max(MIN_MESH_CAPACITY, capacity * 2);
+		while (capacity < count)
+		{
+			capacity *= 2;
+		}
+		device.createBuffer(capacity * elementSize, usage, properties, buffer, memory);
+		frame.cullSetStale = true;
+	};
+	reserve(frame.meshBuffer, frame.meshMemory, frame.meshCapacity, meshCount, sizeof(GpuMesh),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	reserve(frame.indirectBuffer, frame.indirectMemory, frame.indirectCapacity, commandCount, sizeof(VkDrawIndexedIndirectCommand),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	reserve(frame.countBuffer, frame.countMemory, frame.countCapacity, batchCount, sizeof(uint32_t),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
+void SimpleRenderSystem::reserveVisibility(VkCommandBuffer commandBuffer, uint32_t count)
+{
+	if (count <= visibilityCapacity)
+	{
+		return;
+	}
+	// every frame in flight shares the visibility, so they all have to finish with the old buffer
+	if (visibilityBuffer != VK_NULL_HANDLE)
+	{
+		vkDeviceWaitIdle(device.device());
+		device.destroyBuffer(visibilityBuffer, visibilityMemory);
+	}
+	visibilityCapacity = std::max(MIN_OBJECT_CAPACITY, visibilityCapacity * 2);
+	while (visibilityCapacity < count)
+	{
+		visibilityCapacity *= 2;
+	}
+	device.createBuffer(
+		visibilityCapacity * sizeof(uint32_t),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		visibilityBuffer,
+		visibilityMemory);
+	// nothing starts out visible, so the occlusion phase tests everything on the first frame
+	vkCmdFillBuffer(commandBuffer, visibilityBuffer, 0, VK_WHOLE_SIZE, 0);
+	for (FrameResources& frame : frames)
+	{
+		frame.cullSetStale = true;
+	}
+}
+
+Pipeline* SimpleRenderSystem::pipelineFor(const Model& model) const
+{
+	return model.getVertexFormat() == VertexFormat::Packed ? packedPipeline.get() : pipeline.get();
+}
+
+void SimpleRenderSystem::drawVisibleMeshlets(VkCommandBuffer commandBuffer, Model& model, const glm::mat4& projectionViewModel,
+	const glm::mat4& inverseView, const glm::mat4& modelMatrix, uint32_t instance) const
+{
+	const Frustum frustum = Frustum::fromMatrix(projectionViewModel);
+
+	// back facing is invariant under the model matrix, so the test runs in model space
+	const glm::vec3 eye = glm::vec3(glm::inverse(modelMatrix) * inverseView[3]);
+
+	auto isVisible = [&](const Meshlet& meshlet)
+	{
+		if (clusterCullSettings.frustum)
+		{
+			for (const glm::vec4& plane : frustum.planes)
+			{
+				if (glm::dot(glm::vec3(plane), meshlet.center) + plane.w < -meshlet.radius)
+				{
+					return false;
+				}
+			}
+		}
+		if (clusterCullSettings.backface)
+		{
+			const glm::vec3 toCenter = meshlet.center - eye;
+			if (glm::dot(toCenter, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius)
+			{
+				return false;
+			}
+		}
+		return true;
+	};
+
+	// runs of visible meshlets are contiguous indices, one draw each
+	const std::span<const Meshlet> meshlets = model.getMeshlets();
+	uint32_t runStart = 0;
+	uint32_t runLength = 0;
+	for (uint32_t i = 0; i < meshlets.size(); i++)
+	{
+		if (isVisible(meshlets[i]))
+		{
+			runStart = runLength == 0 ? i : runStart;
+			runLength++;
+		}
+		else if (runLength > 0)
+		{
+			model.drawMeshlets(commandBuffer, runStart, runLength, instance);
+			runLength = 0;
+		}
+	}
+	if (runLength > 0)
+	{
+		model.drawMeshlets(commandBuffer, runStart, runLength, instance);
+	}
+}
+
+uint32_t SimpleRenderSystem::selectLod(const Model& model, const BoundingSphere& worldSphere, uint32_t currentLod,
+	const Camera& camera, float viewportHeight) const
+{
+	const uint32_t current = std::min(currentLod, model.getLodCount() - 1);
+
+	// Pixels covered by one unit of model space error, at the distance of the object's nearest possible point
+	// for perspective projections.
+	const glm::mat4& projection = camera.getProjectionMatrix();
+	// the world sphere grew with the largest scale of the world matrix, so model errors do too
+	const float scale = model.getBoundingSphere().radius > 0.0f ? worldSphere.radius / model.getBoundingSphere().radius : 1.0f;
+	float pixelsPerUnit = std::abs(projection[1][1]) * 0.5f * viewportHeight * scale;
+	if (projection[2][3] != 0.0f)
+	{
+		const float distance = glm::length(glm::vec3(camera.getViewMatrix() * glm::vec4(worldSphere.center, 1.0f))) - worldSphere.radius;
+		if (distance <= 0.0f)
+		{
+			return 0;
+		}
+		pixelsPerUnit /= distance;
+	}
+	auto screenError = [&](uint32_t lod)
+	{
+		return model.getLod(lod).error * pixelsPerUnit;
+	};
+
+	// coarsest LOD within the threshold, errors grow with the LOD index
+	uint32_t target = 0;
+	while (target + 1 < model.getLodCount() && screenError(target + 1) <= lodSettings.errorThreshold)
+	{
+		target++;
+	}
+
+	if (target > current)
+	{
+		// only coarsen into LODs comfortably within the threshold
+		while (target > current && screenError(target) > lodSettings.errorThreshold * (1.0f - lodSettings.hysteresis))
+		{
+			target--;
+		}
+	}
+	else if (target < current && screenError(current) <= lodSettings.errorThreshold * (1.0f + lodSettings.hysteresis))
+	{
+		// and keep the current one until it is clearly too coarse
+		target = current;
 	}
+	return target;
 }
\ No newline at end of file
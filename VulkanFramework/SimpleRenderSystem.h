@@ -1,9 +1,15 @@
 #pragma once
 
 #include "Camera.h"
+#include "DepthPyramid.h"
+#include "DrawList.h"
+#include "Descriptors.h"
 #include "Pipeline.h"
 #include "EngineDevice.h"
-#include "GameObject.h"
+#include "FrustumCuller.h"
+#include "EntityStore.h"
+#include "EngineSwapChain.h"
+#include <array>
 #include <memory>
 
 #define GLM_FORCE_RADIANS
@@ -15,8 +21,126 @@ class SimpleRenderSystem
 {
 	struct SimplePushConstantData
 	{
-		glm::mat4 transform{ 1.0f };
-		glm::mat4 normalMatrix{ 1.0f };
+		glm::mat4 decodeMatrix{ 1.0f };
+	};
+	// std140, set 0 binding 0
+	struct CameraUbo
+	{
+		glm::mat4 projectionView{ 1.0f };
+	};
+	// std430, set 0 binding 1, indexed by gl_InstanceIndex
+	struct ObjectData
+	{
+		glm::mat4 modelMatrix;
+		// normal matrix columns in xyz, color in the w components
+		glm::vec4 normalMatrixColor[3];
+		uint32_t materialIndex;
+		// into the frame's GpuMesh array, NO_MESH for entities the GPU path doesn't draw; only set for GPU culling
+		uint32_t meshIndex;
+		uint32_t padding[2];
+	};
+	// std430, cull set binding 1; firstIndex is offset into the geometry pool
+	struct GpuLod
+	{
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		float error;
+		uint32_t padding;
+	};
+	// std430, cull set binding 1, one per model drawn in the frame
+	struct GpuMesh
+	{
+		// model space center in xyz, radius in w
+		glm::vec4 boundingSphere;
+		uint32_t lodCount;
+		int32_t vertexOffset;
+		// the batch whose count and commands the mesh's draws go to
+		uint32_t batch;
+		uint32_t commandBase;
+		GpuLod lods[Model::MAX_LOD_COUNT];
+	};
+	// std140, cull set binding 4
+	struct CullUbo
+	{
+		// for projecting bounds onto the depth pyramid
+		glm::mat4 projectionView;
+		glm::vec4 frustumPlanes[6];
+		// w is 1 for perspective projections
+		glm::vec4 cameraPosition;
+		float projectionScale;
+		float errorThreshold;
+		uint32_t objectCount;
+		uint32_t occlusion;
+		// phase p's commands start at p * commandsPerPhase and its counts at p * batchCount
+		uint32_t commandsPerPhase;
+		uint32_t batchCount;
+		uint32_t padding[2];
+	};
+	// occlusion phase only
+	struct CullPushConstantData
+	{
+		glm::vec2 depthSize;
+		uint32_t pyramidLevelCount;
+		uint32_t padding;
+	};
+	// Models drawn by one indirect call: they share the pipeline, the geometry pool's buffers and the index type,
+	// and packed models also their decode matrix. Commands [commandBase, commandBase + commandCount) of every
+	// phase are theirs.
+	struct IndirectBatch
+	{
+		Model* model;
+		uint32_t commandBase;
+		uint32_t commandCount;
+	};
+	// host visible and mapped, one set per frame in flight so the CPU never writes what the GPU still reads
+	struct FrameResources
+	{
+		VkBuffer cameraBuffer = VK_NULL_HANDLE;
+		MemoryAllocation cameraMemory{};
+		VkBuffer objectBuffer = VK_NULL_HANDLE;
+		MemoryAllocation objectMemory{};
+		uint32_t objectCapacity = 0;
+		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+
+		// GPU culling: meshes are written by the CPU, commands and counts by the cull shader
+		VkBuffer meshBuffer = VK_NULL_HANDLE;
+		MemoryAllocation meshMemory{};
+		uint32_t meshCapacity = 0;
+		VkBuffer indirectBuffer = VK_NULL_HANDLE;
+		MemoryAllocation indirectMemory{};
+		uint32_t indirectCapacity = 0;
+		VkBuffer countBuffer = VK_NULL_HANDLE;
+		MemoryAllocation countMemory{};
+		uint32_t countCapacity = 0;
+		VkBuffer cullUniformBuffer = VK_NULL_HANDLE;
+		MemoryAllocation cullUniformMemory{};
+		VkDescriptorSet cullSet = VK_NULL_HANDLE;
+		// a buffer or image the cull set points to was replaced
+		bool cullSetStale = true;
+		std::vector<IndirectBatch> batches;
+		uint32_t commandsPerPhase = 0;
+	};
+	static constexpr uint32_t MIN_OBJECT_CAPACITY = 1024;
+	static constexpr uint32_t MIN_MESH_CAPACITY = 64;
+	static constexpr uint32_t CULL_GROUP_SIZE = 64;
+	static constexpr uint32_t NO_MESH = ~0u;
+	// draws of last frame's visible objects, then of the objects the depth pyramid shows were missed
+	static constexpr uint32_t OCCLUSION_PHASE_COUNT = 2;
+public:
+	struct LodSettings
+	{
+		// largest error a drawn LOD may show on screen, in pixels
+		float errorThreshold = 1.0f;
+		// fraction of the threshold a LOD must clear before switching to it, so objects
+		// near the switching distance don't pop back and forth
+		float hysteresis = 0.25f;
+	};
+	// Culling of individual meshlets, for models drawn at LOD 0 that have them.
+	struct ClusterCullSettings
+	{
+		bool frustum = true;
+		// the pipeline draws both faces, so only enable this when back faces never show
+		bool backface = false;
 	};
 public:
 	SimpleRenderSystem(EngineDevice& device, VkRenderPass renderPass);
@@ -24,12 +148,125 @@ public:
 	SimpleRenderSystem(const SimpleRenderSystem&) = delete;
 	SimpleRenderSystem& operator=(const SimpleRenderSystem&) = delete;
 
-	void renderGameObjects(VkCommandBuffer commandBuffer, std::vector<GameObject>& gameObjects, const Camera& camera);
+	// Draws with the world matrices of the last EntityStore::updateTransforms, one instanced draw per model and LOD.
+	// Per object data goes to the frame's storage buffer once per frame, shaders index it with the instance.
+	// viewportHeight in pixels, for projecting LOD errors to the screen
+	void renderEntities(VkCommandBuffer commandBuffer, int frameIndex, EntityStore& entities, const Camera& camera,
+		float viewportHeight);
+	// renderEntities in two steps, for recording on several threads. prepareEntities culls, sorts and uploads
+	// and returns the number of draws; recordDraws records [firstDraw, firstDraw + drawCount) of them and may run
+	// concurrently for disjoint ranges and command buffers, until the next prepareEntities.
+	uint32_t prepareEntities(int frameIndex, EntityStore& entities, const Camera& camera, float viewportHeight);
+	CommandRecorder::Stats recordDraws(VkCommandBuffer commandBuffer, int frameIndex, const EntityStore& entities,
+		uint32_t firstDraw, uint32_t drawCount) const;
+	// The GPU driven path, for devices with multiDrawIndirect and drawIndirectFirstInstance. cullEntitiesOnGpu
+	// uploads object data and records the compute pass that culls, picks LODs and writes the indirect draws,
+	// outside the render pass; renderCulledEntities then draws them with one indirect call per batch.
+	// Meshlets and LOD hysteresis are CPU path only, as are the cull stats.
+	bool supportsGpuCulling() const;
+	void cullEntitiesOnGpu(VkCommandBuffer commandBuffer, int frameIndex, EntityStore& entities, const Camera& camera,
+		VkExtent2D viewportExtent);
+	void renderCulledEntities(VkCommandBuffer commandBuffer, int frameIndex, uint32_t phase = 0);
+	// Two phase occlusion culling on the GPU path, which also needs shaderStorageImageExtendedFormats.
+	// Phase 0 then only draws what was visible last frame, into a SwapChainPass::KeepDepth pass;
+	// cullOccludedEntitiesOnGpu builds the depth pyramid from its depth and tests every object against it,
+	// and phase 1 draws the visible ones phase 0 missed into a SwapChainPass::Resume pass.
+	bool supportsOcclusionCulling() const;
+	void setOcclusionCulling(bool enabled)
+	{
+		occlusionCulling = enabled && supportsOcclusionCulling();
+	}
+	bool isOcclusionCulling() const
+	{
+		return occlusionCulling;
+	}
+	// Whether the GPU path draws with vkCmdDrawIndexedIndirectCount, on by default where drawIndirectCount is supported.
+	// Without it every command of a batch is drawn and the unused ones are zeroed; turning it off tests that fallback.
+	void setIndirectCount(bool enabled)
+	{
+		indirectCount = enabled && device.optionalFeatures.drawIndirectCount;
+	}
+	void cullOccludedEntitiesOnGpu(VkCommandBuffer commandBuffer, int frameIndex, VkImageView depthView);
+	void setLodSettings(const LodSettings& settings)
+	{
+		lodSettings = settings;
+	}
+	void setClusterCullSettings(const ClusterCullSettings& settings)
+	{
+		clusterCullSettings = settings;
+	}
+	// objects tested against the view frustum and found visible in the last renderEntities
+	const FrustumCuller::Stats& getCullStats() const
+	{
+		return objectCuller.getStats();
+	}
+	// state changes of the last renderEntities, and what recording its draws in entity order would have taken
+	const DrawList::Stats& getDrawStats() const
+	{
+		return drawStats;
+	}
+	const DrawList::Stats& getUnsortedDrawStats() const
+	{
+		return unsortedDrawStats;
+	}
+	// state commands emitted and skipped as redundant by the last renderEntities or renderCulledEntities
+	const CommandRecorder::Stats& getCommandStats() const
+	{
+		return commandStats;
+	}
 private:
+	void createFrameResources();
 	void createPipelineLayout();
 	void createPipeline(VkRenderPass renderPass);
+	void createCullPipeline();
+	void reserveObjects(FrameResources& frame, uint32_t count);
+	void reserveCullBuffers(FrameResources& frame, uint32_t meshCount, uint32_t commandCount, uint32_t batchCount);
+	void reserveVisibility(VkCommandBuffer commandBuffer, uint32_t count);
+	Pipeline* pipelineFor(const Model& model) const;
+	DrawList::Stats countStateChanges(const EntityStore& entities) const;
+	// the pipeline, geometry and decode matrix drawing the model takes
+	void recordModelState(CommandRecorder& recorder, Model& model) const;
+	uint32_t selectLod(const Model& model, const BoundingSphere& worldSphere, uint32_t currentLod, const Camera& camera,
+		float viewportHeight) const;
+	void drawVisibleMeshlets(VkCommandBuffer commandBuffer, Model& model, const glm::mat4& projectionViewModel, const glm::mat4& inverseView,
+		const glm::mat4& modelMatrix, uint32_t instance) const;
 private:
 	EngineDevice& device;
 	std::unique_ptr<Pipeline> pipeline;
+	std::unique_ptr<Pipeline> packedPipeline;
 	VkPipelineLayout pipelineLayout;
+	LodSettings lodSettings;
+	ClusterCullSettings clusterCullSettings;
+	FrustumCuller objectCuller;
+	// entities with a model, in the order given to the culler, and the culler's numbers of the visible ones
+	std::vector<uint32_t> drawableObjects;
+	std::vector<uint32_t> visibleObjects;
+	// visible entities keyed by their pipeline, model, LOD, material and depth
+	DrawList drawList;
+	// where every draw's run of the draw list starts, and its end
+	std::vector<uint32_t> drawRuns;
+	glm::mat4 projectionView{ 1.0f };
+	glm::mat4 inverseView{ 1.0f };
+	DrawList::Stats drawStats;
+	DrawList::Stats unsortedDrawStats;
+	CommandRecorder::Stats commandStats;
+	// GPU culling: every model's mesh index this frame, and every mesh's model, object count and batch
+	std::vector<uint32_t> meshOfModel;
+	std::vector<uint32_t> meshObjectCounts;
+	std::vector<Model*> meshModels;
+	std::vector<uint32_t> meshBatches;
+	std::unique_ptr<DescriptorSetLayout> frameSetLayout;
+	std::unique_ptr<DescriptorSetLayout> cullSetLayout;
+	VkPipelineLayout cullPipelineLayout = VK_NULL_HANDLE;
+	std::unique_ptr<Pipeline> cullPipeline;
+	std::unique_ptr<Pipeline> occlusionCullPipeline;
+	bool occlusionCulling = false;
+	bool indirectCount;
+	std::unique_ptr<DepthPyramid> depthPyramid;
+	// whether each entity was visible after the last occlusion test, shared by the frames in flight
+	VkBuffer visibilityBuffer = VK_NULL_HANDLE;
+	MemoryAllocation visibilityMemory{};
+	uint32_t visibilityCapacity = 0;
+	std::unique_ptr<DescriptorPool> descriptorPool;
+	std::array<FrameResources, EngineSwapChain::MAX_FRAMES_IN_FLIGHT> frames;
 };
\ No newline at end of file
@@ -3,12 +3,11 @@
 #include <stdexcept>
 #include "first_app.h"
 
-int main() {
-
-    FirstApp app;
+int main(int argc, char* argv[]) {
 
     try
     {
+        FirstApp app{ FirstApp::Options::parse(argc, argv) };
         app.run();
     }
     catch (const std::exception& e)
@@ -0,0 +1,195 @@
+#include "StagingRing.h"
+
+#include <cassert>
+#include <limits>
+#include <stdexcept>
+
+StagingRing::StagingRing(EngineDevice& device, VkDeviceSize size)
+	:
+	device(device)
+{
+	createBuffer(size);
+}
+
+StagingRing::~StagingRing()
+{
+	while (!batches.empty())
+	{
+		reclaim(true);
+	}
+	for (auto fence : freeFences)
+	{
+		vkDestroyFence(device.device(), fence, nullptr);
+	}
+	for (auto& retired : retiredBuffers)
+	{
+		device.destroyBuffer(retired.buffer, retired.memory);
+	}
+	device.destroyBuffer(buffer, bufferMemory);
+}
+
+StagingRing::Region StagingRing::allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+	reclaim(false);
+
+	if (size >= capacity)
+	{
+		grow(size + 1);
+	}
+
+	VkDeviceSize offset = 0;
+	while (!tryAllocate(size, alignment, offset))
+	{
+		// Only regions that were never submitted are left, nothing will free them up.
+		if (batches.empty())
+		{
+			grow(capacity + size + 1);
+			continue;
+		}
+		reclaim(true);
+	}
+	hasPending = true;
+
+	Region region{};
+	region.buffer = buffer;
+	region.offset = offset;
+	region.size = size;
+	region.data = static_cast<char*>(bufferMemory.mappedData) + offset;
+	return region;
+}
+
+VkFence StagingRing::acquireFence()
+{
+	if (!freeFences.empty())
+	{
+		VkFence fence = freeFences.back();
+		freeFences.pop_back();
+		return fence;
+	}
+
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+	VkFence fence;
+	if (vkCreateFence(device.device(), &fenceInfo, nullptr, &fence) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create staging fence!");
+	}
+	return fence;
+}
+
+void StagingRing::retire(VkFence fence)
+{
+	batches.push_back({ fence, head });
+	hasPending = false;
+}
+
+bool StagingRing::tryAllocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset)
+{
+	if (batches.empty() && !hasPending)
+	{
+		head = 0;
+		tail = 0;
+	}
+
+	// The head never catches up with the tail exactly, so head == tail always means empty.
+	const VkDeviceSize alignedHead = (head + alignment - 1) / alignment * alignment;
+	if (head >= tail)
+	{
+		if (alignedHead + size <= capacity)
+		{
+			offset = alignedHead;
+		}
+		else if (size < tail)
+		{
+			offset = 0;
+		}
+		else
+		{
+			return false;
+		}
+	}
+	else if (alignedHead + size < tail)
+	{
+		offset = alignedHead;
+	}
+	else
+	{
+		return false;
+	}
+
+	head = offset + size;
+	return true;
+}
+
+void StagingRing::reclaim(bool waitForOldest)
+{
+	if (waitForOldest && !batches.empty())
+	{
+		vkWaitForFences(device.device(), 1, &batches.front().fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+	}
+
+	while (!batches.empty() && vkGetFenceStatus(device.device(), batches.front().fence) == VK_SUCCESS)
+	{
+		const Batch batch = batches.front();
+		batches.pop_front();
+
+		tail = batch.end;
+		vkResetFences(device.device(), 1, &batch.fence);
+		freeFences.push_back(batch.fence);
+
+		for (auto it = retiredBuffers.begin(); it != retiredBuffers.end();)
+		{
+			if (--it->batchesLeft == 0)
+			{
+				device.destroyBuffer(it->buffer, it->memory);
+				it = retiredBuffers.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+	}
+}
+
+void StagingRing::grow(VkDeviceSize minSize)
+{
+	while (!batches.empty())
+	{
+		reclaim(true);
+	}
+
+	// Regions handed out but not yet submitted still point into the old buffer,
+	// so it lives until the next retired batch completes.
+	if (hasPending)
+	{
+		retiredBuffers.push_back({ buffer, bufferMemory, 1 });
+	}
+	else
+	{
+		device.destroyBuffer(buffer, bufferMemory);
+	}
+
+	VkDeviceSize newCapacity = capacity * 2;
+	while (newCapacity < minSize)
+	{
+		newCapacity *= 2;
+	}
+	createBuffer(newCapacity);
+	head = 0;
+	tail = 0;
+}
+
+void StagingRing::createBuffer(VkDeviceSize size)
+{
+	device.createBuffer(
+		size,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		buffer,
+		bufferMemory);
+	capacity = size;
+
+	assert(bufferMemory.mappedData != nullptr && "Staging ring memory is not mapped!");
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "EngineDevice.h"
+#include <deque>
+#include <vector>
+
+// Persistently mapped host visible buffer that uploads carve their staging space out of.
+// Regions are handed out in ring order and recycled once the fence of the submission
+// that consumed them has signaled. Grows when a single upload doesn't fit.
+class StagingRing
+{
+public:
+	static constexpr VkDeviceSize DEFAULT_SIZE = 16ull * 1024 * 1024;
+
+	struct Region
+	{
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0;
+		VkDeviceSize size = 0;
+		void* data = nullptr;
+	};
+public:
+	StagingRing(EngineDevice& device, VkDeviceSize size = DEFAULT_SIZE);
+	~StagingRing();
+	StagingRing(const StagingRing&) = delete;
+	StagingRing& operator=(const StagingRing&) = delete;
+
+	Region allocate(VkDeviceSize size, VkDeviceSize alignment = 16);
+	// Returns an unsignaled fence owned by the ring, to be passed to the submission that reads the regions.
+	VkFence acquireFence();
+	// Ties every region allocated since the previous call to fence.
+	void retire(VkFence fence);
+
+	VkDeviceSize getSize() const
+	{
+		return capacity;
+	}
+private:
+	struct Batch
+	{
+		VkFence fence;
+		VkDeviceSize end;
+	};
+	struct RetiredBuffer
+	{
+		VkBuffer buffer;
+		MemoryAllocation memory;
+		size_t batchesLeft;
+	};
+
+	bool tryAllocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+	void reclaim(bool waitForOldest);
+	void grow(VkDeviceSize minSize);
+	void createBuffer(VkDeviceSize size);
+private:
+	EngineDevice& device;
+	VkBuffer buffer;
+	MemoryAllocation bufferMemory;
+	VkDeviceSize capacity = 0;
+	VkDeviceSize head = 0;
+	VkDeviceSize tail = 0;
+	bool hasPending = false;
+	std::deque<Batch> batches;
+	std::vector<VkFence> freeFences;
+	std::vector<RetiredBuffer> retiredBuffers;
+};
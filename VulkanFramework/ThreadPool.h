@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for data parallel loops. The calling thread
+// works alongside the workers, so a pool of N threads starts N - 1 workers.
+class ThreadPool
+{
+public:
+	explicit ThreadPool(unsigned int threadCount = std::thread::hardware_concurrency());
+	~ThreadPool();
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	unsigned int getThreadCount() const
+	{
+		return static_cast<unsigned int>(workers.size()) + 1;
+	}
+	// Runs task(i) for every i in [0, count) and returns once all of them finished.
+	// The first exception thrown by a task is rethrown here. Not reentrant.
+	void parallelFor(size_t count, const std::function<void(size_t)>& task);
+private:
+	void workerLoop();
+	void runTasks();
+private:
+	std::vector<std::thread> workers;
+	std::mutex dispatchMutex;
+	std::mutex mutex;
+	std::condition_variable wakeCondition;
+	std::condition_variable doneCondition;
+
+	const std::function<void(size_t)>* currentTask = nullptr;
+	size_t taskCount = 0;
+	std::atomic<size_t> nextTask = 0;
+	size_t busyWorkers = 0;
+	uint64_t generation = 0;
+	bool stopping = false;
+	std::exception_ptr firstException;
+};
@@ -0,0 +1,40 @@
+#include "TransformComponent.h"
+
+void TransformComponent::update() const
+{
+	const float c3 = glm::cos(rotation.z);
+	const float s3 = glm::sin(rotation.z);
+	const float c2 = glm::cos(rotation.x);
+	const float s2 = glm::sin(rotation.x);
+	const float c1 = glm::cos(rotation.y);
+	const float s1 = glm::sin(rotation.y);
+	const glm::mat3 rotationMatrix{
+		{
+			c1 * c3 + s1 * s2 * s3,
+			c2 * s3,
+			c1 * s2 * s3 - c3 * s1,
+		},
+		{
+			c3 * s1 * s2 - c1 * s3,
+			c2 * c3,
+			c1 * c3 * s2 + s1 * s3,
+		},
+		{
+			c2 * s1,
+			-s2,
+			c1 * c2,
+		} };
+
+	// the normal matrix is the inverse transpose of the upper 3x3, which for rotation * scale is rotation / scale
+	const glm::vec3 invScale = 1.0f / scale;
+	matrix = glm::mat4{
+		glm::vec4(rotationMatrix[0] * scale.x, 0.0f),
+		glm::vec4(rotationMatrix[1] * scale.y, 0.0f),
+		glm::vec4(rotationMatrix[2] * scale.z, 0.0f),
+		glm::vec4(translation, 1.0f) };
+	normal = glm::mat3{
+		rotationMatrix[0] * invScale.x,
+		rotationMatrix[1] * invScale.y,
+		rotationMatrix[2] * invScale.z };
+	dirty = false;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// Translation, rotation and scale with the matrices built from them cached, so transforms that
+// don't change cost nothing per frame. Changes go through the setters, which mark the cache stale.
+class TransformComponent
+{
+	// rebuilds the caches of many transforms at once
+	friend class EntityStore;
+public:
+	const glm::vec3& getTranslation() const
+	{
+		return translation;
+	}
+	// Tait-Bryan angles, applied Z, then X, then Y
+	const glm::vec3& getRotation() const
+	{
+		return rotation;
+	}
+	const glm::vec3& getScale() const
+	{
+		return scale;
+	}
+	void setTranslation(const glm::vec3& value)
+	{
+		translation = value;
+		dirty = true;
+		version++;
+	}
+	void setRotation(const glm::vec3& value)
+	{
+		rotation = value;
+		dirty = true;
+		version++;
+	}
+	void setScale(const glm::vec3& value)
+	{
+		scale = value;
+		dirty = true;
+		version++;
+	}
+
+	// changes with every set, so others can tell whether the transform moved since they last looked
+	uint32_t getVersion() const
+	{
+		return version;
+	}
+
+	// Translate * Ry * Rx * Rz * Scale
+	const glm::mat4& mat4() const
+	{
+		if (dirty)
+		{
+			update();
+		}
+		return matrix;
+	}
+	const glm::mat3& normalMatrix() const
+	{
+		if (dirty)
+		{
+			update();
+		}
+		return normal;
+	}
+private:
+	void update() const;
+private:
+	glm::vec3 translation{};
+	glm::vec3 scale{ 1.0f, 1.0f, 1.0f };
+	glm::vec3 rotation{};
+
+	mutable glm::mat4 matrix{ 1.0f };
+	mutable glm::mat3 normal{ 1.0f };
+	mutable bool dirty = true;
+	uint32_t version = 0;
+};
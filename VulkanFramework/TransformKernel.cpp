@@ -0,0 +1,187 @@
+#include "TransformKernel.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRANSFORM_KERNEL_SSE
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	void computeOne(const TransformKernel::Batch& batch, size_t i, glm::mat4& matrix, glm::mat3& normalMatrix)
+	{
+		const float c3 = std::cos(batch.rotationZ[i]);
+		const float s3 = std::sin(batch.rotationZ[i]);
+		const float c2 = std::cos(batch.rotationX[i]);
+		const float s2 = std::sin(batch.rotationX[i]);
+		const float c1 = std::cos(batch.rotationY[i]);
+		const float s1 = std::sin(batch.rotationY[i]);
+		const glm::mat3 rotation{
+			{ c1 * c3 + s1 * s2 * s3, c2 * s3, c1 * s2 * s3 - c3 * s1 },
+			{ c3 * s1 * s2 - c1 * s3, c2 * c3, c1 * c3 * s2 + s1 * s3 },
+			{ c2 * s1, -s2, c1 * c2 } };
+
+		const glm::vec3 scale{ batch.scaleX[i], batch.scaleY[i], batch.scaleZ[i] };
+		const glm::vec3 invScale = 1.0f / scale;
+		matrix = glm::mat4{
+			glm::vec4(rotation[0] * scale.x, 0.0f),
+			glm::vec4(rotation[1] * scale.y, 0.0f),
+			glm::vec4(rotation[2] * scale.z, 0.0f),
+			glm::vec4(batch.translationX[i], batch.translationY[i], batch.translationZ[i], 1.0f) };
+		normalMatrix = glm::mat3{
+			rotation[0] * invScale.x,
+			rotation[1] * invScale.y,
+			rotation[2] * invScale.z };
+	}
+
+#ifdef TRANSFORM_KERNEL_SSE
+	__m128 multiplyAdd(__m128 a, __m128 b, float c)
+	{
+		return _mm_add_ps(_mm_mul_ps(a, b), _mm_set1_ps(c));
+	}
+
+	// Cephes sinf and cosf four lanes at a time: the angle is reduced to [-pi/4, pi/4] around the
+	// nearest even multiple of pi/4, whose octant picks the polynomial and the signs of each result.
+	void sincos(__m128 x, __m128& sinOut, __m128& cosOut)
+	{
+		const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(0x80000000)));
+		__m128 sinSign = _mm_and_ps(x, signMask);
+		x = _mm_andnot_ps(signMask, x);
+
+		__m128i octant = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.27323954473516f)));
+		octant = _mm_and_si128(_mm_add_epi32(octant, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+		const __m128 y = _mm_cvtepi32_ps(octant);
+
+		sinSign = _mm_xor_ps(sinSign, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(octant, _mm_set1_epi32(4)), 29)));
+		const __m128 cosSign = _mm_castsi128_ps(
+			_mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(octant, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+		const __m128 sinPolyMask = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(octant, _mm_set1_epi32(2)), _mm_setzero_si128()));
+
+		// x - y * pi / 4 in three parts for extra precision
+		x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(0.78515625f)));
+		x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(2.4187564849853515625e-4f)));
+		x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(3.77489497744594108e-8f)));
+		const __m128 z = _mm_mul_ps(x, x);
+
+		__m128 cosPoly = multiplyAdd(_mm_set1_ps(2.443315711809948e-5f), z, -1.388731625493765e-3f);
+		cosPoly = multiplyAdd(cosPoly, z, 4.166664568298827e-2f);
+		cosPoly = _mm_mul_ps(_mm_mul_ps(cosPoly, z), z);
+		cosPoly = _mm_add_ps(_mm_sub_ps(cosPoly, _mm_mul_ps(z, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+
+		__m128 sinPoly = multiplyAdd(_mm_set1_ps(-1.9515295891e-4f), z, 8.3321608736e-3f);
+		sinPoly = multiplyAdd(sinPoly, z, -1.6666654611e-1f);
+		sinPoly = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sinPoly, z), x), x);
+
+		sinOut = _mm_xor_ps(_mm_or_ps(_mm_and_ps(sinPolyMask, sinPoly), _mm_andnot_ps(sinPolyMask, cosPoly)), sinSign);
+		cosOut = _mm_xor_ps(_mm_or_ps(_mm_and_ps(sinPolyMask, cosPoly), _mm_andnot_ps(sinPolyMask, sinPoly)), cosSign);
+	}
+#endif
+}
+
+void TransformKernel::Batch::clear()
+{
+	for (std::vector<float>* values : { &translationX, &translationY, &translationZ, &rotationX, &rotationY, &rotationZ,
+		&scaleX, &scaleY, &scaleZ })
+	{
+		values->clear();
+	}
+}
+
+void TransformKernel::Batch::push(const glm::vec3& translation, const glm::vec3& rotation, const glm::vec3& scale)
+{
+	translationX.push_back(translation.x);
+	translationY.push_back(translation.y);
+	translationZ.push_back(translation.z);
+	rotationX.push_back(rotation.x);
+	rotationY.push_back(rotation.y);
+	rotationZ.push_back(rotation.z);
+	scaleX.push_back(scale.x);
+	scaleY.push_back(scale.y);
+	scaleZ.push_back(scale.z);
+}
+
+void TransformKernel::compute(const Batch& batch, glm::mat4* matrices, glm::mat3* normalMatrices)
+{
+	const size_t count = batch.size();
+	size_t i = 0;
+
+#ifdef TRANSFORM_KERNEL_SSE
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 s1, c1, s2, c2, s3, c3;
+		sincos(_mm_loadu_ps(&batch.rotationY[i]), s1, c1);
+		sincos(_mm_loadu_ps(&batch.rotationX[i]), s2, c2);
+		sincos(_mm_loadu_ps(&batch.rotationZ[i]), s3, c3);
+
+		// one register per rotation element, column first
+		const __m128 s1s2 = _mm_mul_ps(s1, s2);
+		const __m128 c1s2 = _mm_mul_ps(c1, s2);
+		const __m128 r00 = _mm_add_ps(_mm_mul_ps(c1, c3), _mm_mul_ps(s1s2, s3));
+		const __m128 r01 = _mm_mul_ps(c2, s3);
+		const __m128 r02 = _mm_sub_ps(_mm_mul_ps(c1s2, s3), _mm_mul_ps(c3, s1));
+		const __m128 r10 = _mm_sub_ps(_mm_mul_ps(s1s2, c3), _mm_mul_ps(c1, s3));
+		const __m128 r11 = _mm_mul_ps(c2, c3);
+		const __m128 r12 = _mm_add_ps(_mm_mul_ps(c1s2, c3), _mm_mul_ps(s1, s3));
+		const __m128 r20 = _mm_mul_ps(c2, s1);
+		const __m128 r21 = _mm_sub_ps(zero, s2);
+		const __m128 r22 = _mm_mul_ps(c1, c2);
+
+		const __m128 sx = _mm_loadu_ps(&batch.scaleX[i]);
+		const __m128 sy = _mm_loadu_ps(&batch.scaleY[i]);
+		const __m128 sz = _mm_loadu_ps(&batch.scaleZ[i]);
+		const __m128 invSx = _mm_div_ps(one, sx);
+		const __m128 invSy = _mm_div_ps(one, sy);
+		const __m128 invSz = _mm_div_ps(one, sz);
+
+		// transposing four element registers gives the same column of four objects
+		auto storeColumn = [&](int column, __m128 x, __m128 y, __m128 z, __m128 w)
+		{
+			_MM_TRANSPOSE4_PS(x, y, z, w);
+			_mm_storeu_ps(&matrices[i][column][0], x);
+			_mm_storeu_ps(&matrices[i + 1][column][0], y);
+			_mm_storeu_ps(&matrices[i + 2][column][0], z);
+			_mm_storeu_ps(&matrices[i + 3][column][0], w);
+		};
+		storeColumn(0, _mm_mul_ps(r00, sx), _mm_mul_ps(r01, sx), _mm_mul_ps(r02, sx), zero);
+		storeColumn(1, _mm_mul_ps(r10, sy), _mm_mul_ps(r11, sy), _mm_mul_ps(r12, sy), zero);
+		storeColumn(2, _mm_mul_ps(r20, sz), _mm_mul_ps(r21, sz), _mm_mul_ps(r22, sz), zero);
+		storeColumn(3, _mm_loadu_ps(&batch.translationX[i]), _mm_loadu_ps(&batch.translationY[i]), _mm_loadu_ps(&batch.translationZ[i]), one);
+
+		// normal matrix columns have three floats, so they go through memory
+		auto storeNormalColumn = [&](int column, __m128 x, __m128 y, __m128 z)
+		{
+			__m128 w = zero;
+			_MM_TRANSPOSE4_PS(x, y, z, w);
+			float lanes[4][4];
+			_mm_storeu_ps(lanes[0], x);
+			_mm_storeu_ps(lanes[1], y);
+			_mm_storeu_ps(lanes[2], z);
+			_mm_storeu_ps(lanes[3], w);
+			for (size_t k = 0; k < 4; k++)
+			{
+				std::memcpy(&normalMatrices[i + k][column][0], lanes[k], sizeof(glm::vec3));
+			}
+		};
+		storeNormalColumn(0, _mm_mul_ps(r00, invSx), _mm_mul_ps(r01, invSx), _mm_mul_ps(r02, invSx));
+		storeNormalColumn(1, _mm_mul_ps(r10, invSy), _mm_mul_ps(r11, invSy), _mm_mul_ps(r12, invSy));
+		storeNormalColumn(2, _mm_mul_ps(r20, invSz), _mm_mul_ps(r21, invSz), _mm_mul_ps(r22, invSz));
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		computeOne(batch, i, matrices[i], normalMatrices[i]);
+	}
+}
+
+void TransformKernel::computeReference(const Batch& batch, glm::mat4* matrices, glm::mat3* normalMatrices)
+{
+	for (size_t i = 0; i < batch.size(); i++)
+	{
+		computeOne(batch, i, matrices[i], normalMatrices[i]);
+	}
+}
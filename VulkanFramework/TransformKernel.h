@@ -0,0 +1,38 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// Model and normal matrices for many transforms at once, laid out as TransformComponent builds
+// them (Translate * Ry * Rx * Rz * Scale). The inputs are structure of arrays so four objects
+// go through every SSE instruction, sin and cos included.
+namespace TransformKernel
+{
+	struct Batch
+	{
+		std::vector<float> translationX;
+		std::vector<float> translationY;
+		std::vector<float> translationZ;
+		std::vector<float> rotationX;
+		std::vector<float> rotationY;
+		std::vector<float> rotationZ;
+		std::vector<float> scaleX;
+		std::vector<float> scaleY;
+		std::vector<float> scaleZ;
+
+		void clear();
+		void push(const glm::vec3& translation, const glm::vec3& rotation, const glm::vec3& scale);
+		size_t size() const
+		{
+			return translationX.size();
+		}
+	};
+
+	// Writes batch.size() matrices to each output.
+	void compute(const Batch& batch, glm::mat4* matrices, glm::mat3* normalMatrices);
+	// One object at a time with std::sin and std::cos, to check compute against.
+	void computeReference(const Batch& batch, glm::mat4* matrices, glm::mat3* normalMatrices);
+}
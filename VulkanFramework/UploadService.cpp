@@ -0,0 +1,268 @@
+#include "UploadService.h"
+#include "StagingRing.h"
+
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+UploadService::UploadService(EngineDevice& device)
+	:
+	device(device)
+{
+	QueueFamilyIndices indices = device.findPhysicalQueueFamilies();
+	queueFamily = indices.transferFamily;
+	graphicsFamily = indices.graphicsFamily;
+	queue = device.transferQueue();
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.queueFamilyIndex = queueFamily;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+	if (vkCreateCommandPool(device.device(), &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create upload command pool!");
+	}
+
+	VkSemaphoreTypeCreateInfo timelineInfo{};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	timelineInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	timelineInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreInfo.pNext = &timelineInfo;
+
+	if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &timelineSemaphore) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create upload timeline semaphore!");
+	}
+}
+
+UploadService::~UploadService()
+{
+	wait(flush());
+
+	vkDestroyCommandPool(device.device(), commandPool, nullptr);
+	vkDestroySemaphore(device.device(), timelineSemaphore, nullptr);
+}
+
+void UploadService::uploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size)
+{
+	memcpy(stageBuffer(dstBuffer, dstOffset, size), data, static_cast<size_t>(size));
+}
+
+void* UploadService::stageBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, VkDeviceSize size)
+{
+	// Unsubmitted regions can't be recycled, so don't let one batch hog the whole ring.
+	StagingRing& stagingRing = device.stagingRing();
+	if (pendingStagingBytes + size > stagingRing.getSize() / 2)
+	{
+		flush();
+	}
+	pendingStagingBytes += size;
+
+	StagingRing::Region staging = stagingRing.allocate(size);
+	copyBuffer(staging.buffer, staging.offset, dstBuffer, dstOffset, size);
+	return staging.data;
+}
+
+void UploadService::copyBuffer(VkBuffer srcBuffer, VkDeviceSize srcOffset, VkBuffer dstBuffer, VkDeviceSize dstOffset, VkDeviceSize size)
+{
+	VkCommandBuffer commandBuffer = getRecordingCommandBuffer();
+
+	VkBufferCopy copyRegion{};
+	copyRegion.srcOffset = srcOffset;
+	copyRegion.dstOffset = dstOffset;
+	copyRegion.size = size;
+	vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+
+	if (queueFamily != graphicsFamily)
+	{
+		VkBufferMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = 0;
+		barrier.srcQueueFamilyIndex = queueFamily;
+		barrier.dstQueueFamilyIndex = graphicsFamily;
+		barrier.buffer = dstBuffer;
+		barrier.offset = dstOffset;
+		barrier.size = size;
+		releaseBarriers.push_back(barrier);
+	}
+}
+
+UploadToken UploadService::flush()
+{
+	if (recording == VK_NULL_HANDLE)
+	{
+		return { nextValue - 1 };
+	}
+
+	if (!releaseBarriers.empty())
+	{
+		vkCmdPipelineBarrier(
+			recording,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			0,
+			0, nullptr,
+			static_cast<uint32_t>(releaseBarriers.size()), releaseBarriers.data(),
+			0, nullptr);
+	}
+
+	if (vkEndCommandBuffer(recording) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to record upload command buffer!");
+	}
+
+	const uint64_t value = nextValue++;
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo{};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.signalSemaphoreValueCount = 1;
+	timelineInfo.pSignalSemaphoreValues = &value;
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &recording;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &timelineSemaphore;
+
+	// the fence hands the staging regions read by this batch back to the ring
+	StagingRing& stagingRing = device.stagingRing();
+	VkFence fence = stagingRing.acquireFence();
+	if (vkQueueSubmit(queue, 1, &submitInfo, fence) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to submit upload command buffer!");
+	}
+	stagingRing.retire(fence);
+
+	inFlight.push_back({ recording, value });
+	recording = VK_NULL_HANDLE;
+
+	for (auto barrier : releaseBarriers)
+	{
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		pendingAcquires.push_back(barrier);
+	}
+	releaseBarriers.clear();
+	pendingAcquireValue = value;
+	pendingStagingBytes = 0;
+
+	return { value };
+}
+
+bool UploadService::isComplete(UploadToken token) const
+{
+	// a pending token with nothing recorded has no work to wait for
+	if (token.value >= nextValue)
+	{
+		return recording == VK_NULL_HANDLE;
+	}
+	return completedValue() >= token.value;
+}
+
+void UploadService::wait(UploadToken token)
+{
+	if (token.value >= nextValue)
+	{
+		flush();
+	}
+	if (token.value == 0 || token.value >= nextValue)
+	{
+		return;
+	}
+
+	VkSemaphoreWaitInfo waitInfo{};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &timelineSemaphore;
+	waitInfo.pValues = &token.value;
+
+	vkWaitSemaphores(device.device(), &waitInfo, std::numeric_limits<uint64_t>::max());
+	recycleCompletedBatches();
+}
+
+uint64_t UploadService::acquireOnGraphics(VkCommandBuffer commandBuffer)
+{
+	flush();
+
+	if (!pendingAcquires.empty())
+	{
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+			VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+			0,
+			0, nullptr,
+			static_cast<uint32_t>(pendingAcquires.size()), pendingAcquires.data(),
+			0, nullptr);
+		pendingAcquires.clear();
+	}
+
+	const uint64_t waitValue = pendingAcquireValue;
+	pendingAcquireValue = 0;
+	return waitValue;
+}
+
+VkCommandBuffer UploadService::getRecordingCommandBuffer()
+{
+	if (recording != VK_NULL_HANDLE)
+	{
+		return recording;
+	}
+
+	recycleCompletedBatches();
+
+	if (!freeCommandBuffers.empty())
+	{
+		recording = freeCommandBuffers.back();
+		freeCommandBuffers.pop_back();
+	}
+	else
+	{
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandPool = commandPool;
+		allocInfo.commandBufferCount = 1;
+
+		if (vkAllocateCommandBuffers(device.device(), &allocInfo, &recording) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to allocate upload command buffer!");
+		}
+	}
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	if (vkBeginCommandBuffer(recording, &beginInfo) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to begin upload command buffer!");
+	}
+
+	return recording;
+}
+
+void UploadService::recycleCompletedBatches()
+{
+	const uint64_t completed = completedValue();
+	while (!inFlight.empty() && inFlight.front().value <= completed)
+	{
+		vkResetCommandBuffer(inFlight.front().commandBuffer, 0);
+		freeCommandBuffers.push_back(inFlight.front().commandBuffer);
+		inFlight.pop_front();
+	}
+}
+
+uint64_t UploadService::completedValue() const
+{
+	uint64_t value = 0;
+	vkGetSemaphoreCounterValue(device.device(), timelineSemaphore, &value);
+	return value;
+}
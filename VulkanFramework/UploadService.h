@@ -0,0 +1,78 @@
+#pragma once
+
+#include "EngineDevice.h"
+#include <deque>
+#include <vector>
+
+// Timeline semaphore value an upload batch signals when its copies have landed.
+// A default constructed token is always complete.
+struct UploadToken
+{
+	uint64_t value = 0;
+};
+
+// Records buffer uploads on the transfer queue (the graphics queue when the device has
+// no dedicated transfer family) without stalling the CPU. Copies accumulate in one
+// command buffer until flush(), which submits them and signals the timeline semaphore.
+// With separate queue families every destination range is released by the transfer
+// queue; acquireOnGraphics() records the matching acquire on the graphics side.
+class UploadService
+{
+public:
+	UploadService(EngineDevice& device);
+	~UploadService();
+	UploadService(const UploadService&) = delete;
+	UploadService& operator=(const UploadService&) = delete;
+
+	// Copies data into the staging ring and records its transfer to dstBuffer.
+	void uploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+	// uploadBuffer for data converted on the way in: returns the staging memory to write it to,
+	// which must be filled before the next call into the service.
+	void* stageBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, VkDeviceSize size);
+	// Records a copy out of a region the caller filled itself, e.g. StagingRing::allocate.
+	void copyBuffer(VkBuffer srcBuffer, VkDeviceSize srcOffset, VkBuffer dstBuffer, VkDeviceSize dstOffset, VkDeviceSize size);
+
+	UploadToken flush();
+	// Token of the batch currently being recorded.
+	UploadToken pendingToken() const
+	{
+		return { nextValue };
+	}
+	bool isComplete(UploadToken token) const;
+	void wait(UploadToken token);
+
+	// Flushes outstanding copies, records queue family acquire barriers for everything released
+	// since the last call and returns the timeline value the graphics submission must wait on (0 for none).
+	uint64_t acquireOnGraphics(VkCommandBuffer commandBuffer);
+	VkSemaphore getTimelineSemaphore() const
+	{
+		return timelineSemaphore;
+	}
+private:
+	struct Batch
+	{
+		VkCommandBuffer commandBuffer;
+		uint64_t value;
+	};
+
+	VkCommandBuffer getRecordingCommandBuffer();
+	void recycleCompletedBatches();
+	uint64_t completedValue() const;
+private:
+	EngineDevice& device;
+	VkQueue queue;
+	uint32_t queueFamily;
+	uint32_t graphicsFamily;
+	VkCommandPool commandPool;
+	VkSemaphore timelineSemaphore;
+	uint64_t nextValue = 1;
+
+	VkCommandBuffer recording = VK_NULL_HANDLE;
+	VkDeviceSize pendingStagingBytes = 0;
+	std::vector<VkBufferMemoryBarrier> releaseBarriers;
+	std::vector<VkBufferMemoryBarrier> pendingAcquires;
+	uint64_t pendingAcquireValue = 0;
+
+	std::deque<Batch> inFlight;
+	std::vector<VkCommandBuffer> freeCommandBuffers;
+};
@@ -1,9 +1,34 @@
 #pragma once
 
+#include <cstdint>
+#include <cstring>
 #include <functional>
 
 template <typename T, typename... Rest>
 void hashCombine(std::size_t& seed, const T& v, const Rest&... rest) {
 	seed ^= std::hash<T>{}(v)+0x9e3779b9 + (seed << 6) + (seed >> 2);
 	(hashCombine(seed, rest), ...);
-};
\ No newline at end of file
+};
+
+// 64-bit hash of a byte range, consumed a word at a time. Not cryptographic;
+// meant for checksums of on-disk data and change detection.
+inline uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0) {
+	const uint64_t multiplier = 0x9e3779b97f4a7c15ull;
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	uint64_t hash = seed ^ (size * multiplier);
+
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		uint64_t word;
+		memcpy(&word, bytes + i, 8);
+		hash = (hash ^ word) * multiplier;
+		hash ^= hash >> 32;
+	}
+	uint64_t tail = 0;
+	if (i < size) {
+		memcpy(&tail, bytes + i, size - i);
+	}
+	hash = (hash ^ tail) * multiplier;
+	hash ^= hash >> 29;
+	return hash;
+}
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include "VertexDeduplication.h"
+#include "VertexHashTable.h"
+
+#include <algorithm>
+
+namespace
+{
+	constexpr uint32_t DEDUP_SHARD_BITS = 6;
+}
+
+namespace VertexDeduplication
+{
+	Model::Vertex vertexAt(const ObjLoader::Mesh& mesh, size_t cornerIndex)
+	{
+		const ObjLoader::Corner& corner = mesh.corners[cornerIndex];
+		Model::Vertex vertex{};
+
+		if (corner.position >= 0)
+		{
+			vertex.position = mesh.positions[corner.position];
+			vertex.color = mesh.colors[corner.position];
+		}
+
+		if (corner.normal >= 0)
+		{
+			vertex.normal = mesh.normals[corner.normal];
+		}
+
+		if (corner.texcoord >= 0)
+		{
+			vertex.uv = mesh.texcoords[corner.texcoord];
+		}
+
+		return vertex;
+	}
+
+	void deduplicate(const ObjLoader::Mesh& mesh, std::vector<Model::Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		// closed meshes end up with roughly half as many vertices as triangles, the table grows past that
+		VertexHashTable uniqueVertices{ mesh.corners.size() / 3 };
+		indices.reserve(mesh.corners.size());
+
+		for (size_t i = 0; i < mesh.corners.size(); i++)
+		{
+			const Model::Vertex vertex = vertexAt(mesh, i);
+			const uint32_t next = static_cast<uint32_t>(vertices.size());
+			const uint32_t index = uniqueVertices.findOrInsert(vertex, VertexHashTable::hash(vertex), next,
+				[&](uint32_t other) -> const Model::Vertex& { return vertices[other]; });
+
+			if (index == next)
+			{
+				vertices.push_back(vertex);
+			}
+			indices.push_back(index);
+		}
+	}
+
+	// Corners are sharded by hash so every shard dedups independently, each mapping its corners
+	// to the first equal corner. A final in-order pass numbers the vertices by first use, which
+	// makes the output identical to deduplicate().
+	void deduplicateParallel(const ObjLoader::Mesh& mesh, ThreadPool& threadPool,
+		std::vector<Model::Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		constexpr size_t shardCount = size_t(1) << DEDUP_SHARD_BITS;
+		constexpr uint32_t shardShift = 32 - DEDUP_SHARD_BITS;
+		const size_t cornerCount = mesh.corners.size();
+		const size_t rangeCount = threadPool.getThreadCount() * 4;
+		const size_t rangeSize = (cornerCount + rangeCount - 1) / rangeCount;
+
+		std::vector<uint32_t> hashes(cornerCount);
+		// per range and shard: corner count, then the range's first slot in shardCorners
+		std::vector<size_t> shardCursors(rangeCount * shardCount);
+
+		threadPool.parallelFor(rangeCount, [&](size_t range)
+			{
+				size_t* counts = &shardCursors[range * shardCount];
+				const size_t end = std::min(cornerCount, (range + 1) * rangeSize);
+				for (size_t i = range * rangeSize; i < end; i++)
+				{
+					hashes[i] = VertexHashTable::hash(vertexAt(mesh, i));
+					counts[hashes[i] >> shardShift]++;
+				}
+			});
+
+		std::vector<size_t> shardBegin(shardCount + 1);
+		size_t offset = 0;
+		for (size_t shard = 0; shard < shardCount; shard++)
+		{
+			shardBegin[shard] = offset;
+			for (size_t range = 0; range < rangeCount; range++)
+			{
+				const size_t count = shardCursors[range * shardCount + shard];
+				shardCursors[range * shardCount + shard] = offset;
+				offset += count;
+			}
+		}
+		shardBegin[shardCount] = offset;
+
+		std::vector<uint32_t> shardCorners(cornerCount);
+		threadPool.parallelFor(rangeCount, [&](size_t range)
+			{
+				size_t* cursors = &shardCursors[range * shardCount];
+				const size_t end = std::min(cornerCount, (range + 1) * rangeSize);
+				for (size_t i = range * rangeSize; i < end; i++)
+				{
+					shardCorners[cursors[hashes[i] >> shardShift]++] = static_cast<uint32_t>(i);
+				}
+			});
+
+		indices.resize(cornerCount);
+		threadPool.parallelFor(shardCount, [&](size_t shard)
+			{
+				VertexHashTable firstCorners{ (shardBegin[shard + 1] - shardBegin[shard]) / 3 };
+				for (size_t i = shardBegin[shard]; i < shardBegin[shard + 1]; i++)
+				{
+					const uint32_t corner = shardCorners[i];
+					indices[corner] = firstCorners.findOrInsert(vertexAt(mesh, corner), hashes[corner], corner,
+						[&](uint32_t other) { return vertexAt(mesh, other); });
+				}
+			});
+
+		for (size_t i = 0; i < cornerCount; i++)
+		{
+			const uint32_t firstCorner = indices[i];
+			if (firstCorner == i)
+			{
+				indices[i] = static_cast<uint32_t>(vertices.size());
+				vertices.push_back(vertexAt(mesh, i));
+			}
+			else
+			{
+				indices[i] = indices[firstCorner];
+			}
+		}
+	}
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "Model.h"
+#include "ObjLoader.h"
+#include "ThreadPool.h"
+#include <vector>
+
+// Turns the corners of a loaded OBJ into an indexed vertex list. Vertices are numbered
+// by first use, so both functions produce the same output for the same mesh.
+namespace VertexDeduplication
+{
+	// The vertex a corner refers to, zeroed where the corner has no attribute.
+	Model::Vertex vertexAt(const ObjLoader::Mesh& mesh, size_t cornerIndex);
+
+	void deduplicate(const ObjLoader::Mesh& mesh, std::vector<Model::Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	// Shards the corners by hash and dedups the shards on the pool. Only pays off for large meshes.
+	void deduplicateParallel(const ObjLoader::Mesh& mesh, ThreadPool& threadPool,
+		std::vector<Model::Vertex>& vertices, std::vector<uint32_t>& indices);
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "Model.h"
+#include "Utils.h"
+#include <cstring>
+#include <vector>
+
+// Open addressing set used to deduplicate vertices. Slots hold caller defined indices
+// (vertex or corner numbers) plus the 32-bit hash; the vertices themselves are
+// looked up through a callback, so the table never copies them. Equality is Vertex::operator==,
+// the hash is bitwise with -0.0 folded into 0.0 to stay consistent with it.
+class VertexHashTable
+{
+public:
+	static constexpr uint32_t EMPTY = UINT32_MAX;
+
+	explicit VertexHashTable(size_t expectedCount)
+	{
+		size_t capacity = 16;
+		while (capacity < expectedCount * 2)
+		{
+			capacity *= 2;
+		}
+		slots.assign(capacity, { EMPTY, 0 });
+	}
+
+	static uint32_t hash(const Model::Vertex& vertex)
+	{
+		float values[11] = {
+			vertex.position.x, vertex.position.y, vertex.position.z,
+			vertex.color.r, vertex.color.g, vertex.color.b,
+			vertex.normal.x, vertex.normal.y, vertex.normal.z,
+			vertex.uv.x, vertex.uv.y };
+		for (float& value : values)
+		{
+			if (value == 0.0f)
+			{
+				value = 0.0f;
+			}
+		}
+		return static_cast<uint32_t>(hashBytes(values, sizeof(values)));
+	}
+
+	// Returns the index stored for a vertex equal to vertex, or stores index and returns it.
+	// getVertex(i) must return the vertex of any index stored so far.
+	template<typename GetVertex>
+	uint32_t findOrInsert(const Model::Vertex& vertex, uint32_t vertexHash, uint32_t index, GetVertex&& getVertex)
+	{
+		if ((count + 1) * 2 > slots.size())
+		{
+			grow();
+		}
+
+		const size_t mask = slots.size() - 1;
+		for (size_t i = probeStart(vertexHash) & mask;; i = (i + 1) & mask)
+		{
+			Slot& slot = slots[i];
+			if (slot.index == EMPTY)
+			{
+				slot = { index, vertexHash };
+				count++;
+				return index;
+			}
+			if (slot.hash == vertexHash && getVertex(slot.index) == vertex)
+			{
+				return slot.index;
+			}
+		}
+	}
+	size_t size() const
+	{
+		return count;
+	}
+private:
+	struct Slot
+	{
+		uint32_t index;
+		uint32_t hash;
+	};
+
+	// Scrambles the hash so that callers sharding on its top bits don't crowd one end of the table.
+	static size_t probeStart(uint32_t vertexHash)
+	{
+		return static_cast<size_t>((vertexHash * 0x9e3779b97f4a7c15ull) >> 32);
+	}
+	void grow()
+	{
+		std::vector<Slot> old = std::move(slots);
+		slots.assign(old.size() * 2, { EMPTY, 0 });
+		const size_t mask = slots.size() - 1;
+		for (const Slot& slot : old)
+		{
+			if (slot.index == EMPTY)
+			{
+				continue;
+			}
+			size_t i = probeStart(slot.hash) & mask;
+			while (slots[i].index != EMPTY)
+			{
+				i = (i + 1) & mask;
+			}
+			slots[i] = slot;
+		}
+	}
+private:
+	std::vector<Slot> slots;
+	size_t count = 0;
+};
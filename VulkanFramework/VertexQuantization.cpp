@@ -0,0 +1,165 @@
+#include "VertexQuantization.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+
+namespace
+{
+	int16_t toSnorm16(float value)
+	{
+		return static_cast<int16_t>(std::round(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+	}
+
+	float fromSnorm16(int16_t value)
+	{
+		return std::max(static_cast<float>(value) / 32767.0f, -1.0f);
+	}
+
+	template<glm::length_t L>
+	float maxAbsDifference(const glm::vec<L, float>& a, const glm::vec<L, float>& b)
+	{
+		float result = 0.0f;
+		for (glm::length_t i = 0; i < L; i++)
+		{
+			result = std::max(result, std::abs(a[i] - b[i]));
+		}
+		return result;
+	}
+}
+
+glm::vec2 VertexQuantization::encodeOctahedral(const glm::vec3& normal)
+{
+	const float sum = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+	if (sum == 0.0f)
+	{
+		return glm::vec2{ 0.0f };
+	}
+
+	glm::vec2 encoded = glm::vec2{ normal.x, normal.y } / sum;
+	if (normal.z < 0.0f)
+	{
+		encoded = glm::vec2{
+			(1.0f - std::abs(encoded.y)) * (encoded.x >= 0.0f ? 1.0f : -1.0f),
+			(1.0f - std::abs(encoded.x)) * (encoded.y >= 0.0f ? 1.0f : -1.0f) };
+	}
+	return encoded;
+}
+
+glm::vec3 VertexQuantization::decodeOctahedral(const glm::vec2& encoded)
+{
+	glm::vec3 normal{ encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y) };
+	const float t = std::max(-normal.z, 0.0f);
+	normal.x += normal.x >= 0.0f ? -t : t;
+	normal.y += normal.y >= 0.0f ? -t : t;
+	return glm::normalize(normal);
+}
+
+Model::PackedVertex VertexQuantization::pack(const Model::Vertex& vertex, const glm::vec3& boundsMin, const glm::vec3& boundsExtent)
+{
+	Model::PackedVertex packed{};
+
+	for (int i = 0; i < 3; i++)
+	{
+		const float relative = boundsExtent[i] > 0.0f ? (vertex.position[i] - boundsMin[i]) / boundsExtent[i] : 0.0f;
+		packed.position[i] = static_cast<uint16_t>(std::round(std::clamp(relative, 0.0f, 1.0f) * 65535.0f));
+	}
+
+	// Rounding each component on its own is off by up to a full step; try the four
+	// neighbouring grid points and keep the one that decodes closest to the input.
+	const float length = glm::length(vertex.normal);
+	if (length > 0.0f)
+	{
+		const glm::vec3 normal = vertex.normal / length;
+		const glm::vec2 encoded = encodeOctahedral(normal) * 32767.0f;
+		float bestDot = -2.0f;
+		for (int i = 0; i < 4; i++)
+		{
+			const int16_t x = toSnorm16((i & 1 ? std::ceil(encoded.x) : std::floor(encoded.x)) / 32767.0f);
+			const int16_t y = toSnorm16((i & 2 ? std::ceil(encoded.y) : std::floor(encoded.y)) / 32767.0f);
+			const float dot = glm::dot(normal, decodeOctahedral({ fromSnorm16(x), fromSnorm16(y) }));
+			if (dot > bestDot)
+			{
+				bestDot = dot;
+				packed.normal[0] = x;
+				packed.normal[1] = y;
+			}
+		}
+	}
+
+	for (int i = 0; i < 3; i++)
+	{
+		packed.color[i] = static_cast<uint8_t>(std::round(std::clamp(vertex.color[i], 0.0f, 1.0f) * 255.0f));
+	}
+	packed.color[3] = 255;
+
+	packed.uv[0] = glm::packHalf1x16(vertex.uv.x);
+	packed.uv[1] = glm::packHalf1x16(vertex.uv.y);
+
+	return packed;
+}
+
+Model::Vertex VertexQuantization::unpack(const Model::PackedVertex& vertex, const glm::vec3& boundsMin, const glm::vec3& boundsExtent)
+{
+	Model::Vertex unpacked{};
+
+	for (int i = 0; i < 3; i++)
+	{
+		unpacked.position[i] = boundsMin[i] + static_cast<float>(vertex.position[i]) / 65535.0f * boundsExtent[i];
+		unpacked.color[i] = static_cast<float>(vertex.color[i]) / 255.0f;
+	}
+	unpacked.normal = decodeOctahedral({ fromSnorm16(vertex.normal[0]), fromSnorm16(vertex.normal[1]) });
+	unpacked.uv = { glm::unpackHalf1x16(vertex.uv[0]), glm::unpackHalf1x16(vertex.uv[1]) };
+
+	return unpacked;
+}
+
+void VertexQuantization::packVertices(std::span<const Model::Vertex> vertices, Model::PackedVertex* packed, glm::mat4& decodeMatrix,
+	Model::QuantizationError* error)
+{
+	glm::vec3 boundsMin{ 0.0f };
+	glm::vec3 boundsMax{ 0.0f };
+	if (!vertices.empty())
+	{
+		boundsMin = boundsMax = vertices[0].position;
+	}
+	for (const auto& vertex : vertices)
+	{
+		boundsMin = glm::min(boundsMin, vertex.position);
+		boundsMax = glm::max(boundsMax, vertex.position);
+	}
+	const glm::vec3 boundsExtent = boundsMax - boundsMin;
+
+	// The unorm attribute already divides by 65535, so decoding is min + value * extent.
+	decodeMatrix = glm::scale(glm::translate(glm::mat4{ 1.0f }, boundsMin), boundsExtent);
+
+	if (error)
+	{
+		*error = {};
+	}
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		// measured on the local copy, reading packed back could be slow
+		const Model::PackedVertex vertex = pack(vertices[i], boundsMin, boundsExtent);
+		packed[i] = vertex;
+
+		if (error)
+		{
+			const Model::Vertex& original = vertices[i];
+			const Model::Vertex decoded = unpack(vertex, boundsMin, boundsExtent);
+
+			error->position = std::max(error->position, glm::length(decoded.position - original.position));
+			error->color = std::max(error->color, maxAbsDifference(decoded.color, original.color));
+			error->uv = std::max(error->uv, maxAbsDifference(decoded.uv, original.uv));
+
+			const float length = glm::length(original.normal);
+			if (length > 0.0f)
+			{
+				const float cosine = std::clamp(glm::dot(original.normal / length, decoded.normal), -1.0f, 1.0f);
+				error->normalDegrees = std::max(error->normalDegrees, glm::degrees(std::acos(cosine)));
+			}
+		}
+	}
+}
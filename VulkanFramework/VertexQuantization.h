@@ -0,0 +1,24 @@
+#pragma once
+
+#include "Model.h"
+#include <span>
+#include <vector>
+
+// Conversion between Model::Vertex and Model::PackedVertex. The unpack side
+// mirrors the decode done by the vertex input formats and simple_shader_packed.vert.
+namespace VertexQuantization
+{
+	// Octahedral mapping of a unit vector onto [-1, 1]^2.
+	glm::vec2 encodeOctahedral(const glm::vec3& normal);
+	glm::vec3 decodeOctahedral(const glm::vec2& encoded);
+
+	Model::PackedVertex pack(const Model::Vertex& vertex, const glm::vec3& boundsMin, const glm::vec3& boundsExtent);
+	// Positions come back in model space.
+	Model::Vertex unpack(const Model::PackedVertex& vertex, const glm::vec3& boundsMin, const glm::vec3& boundsExtent);
+
+	// Packs into vertices.size() elements of packed relative to the bounds of vertices and returns the matrix
+	// that maps decoded positions back to model space. Fills error with the largest deviation from the input
+	// when given. packed is only written, so it may be staging memory.
+	void packVertices(std::span<const Model::Vertex> vertices, Model::PackedVertex* packed, glm::mat4& decodeMatrix,
+		Model::QuantizationError* error = nullptr);
+}
@@ -1,3 +1,7 @@
 "C:\VulkanSDK\1.3.211.0\Bin\glslc.exe" Shaders\simple_shader.vert -o Shaders\simple_shader.vert.spv
+"C:\VulkanSDK\1.3.211.0\Bin\glslc.exe" Shaders\simple_shader_packed.vert -o Shaders\simple_shader_packed.vert.spv
 "C:\VulkanSDK\1.3.211.0\Bin\glslc.exe" Shaders\simple_shader.frag -o Shaders\simple_shader.frag.spv
+"C:\VulkanSDK\1.3.211.0\Bin\glslc.exe" Shaders\cull.comp -o Shaders\cull.comp.spv
+"C:\VulkanSDK\1.3.211.0\Bin\glslc.exe" Shaders\cull.comp -DOCCLUSION_PHASE -o Shaders\cull_occlusion.comp.spv
+"C:\VulkanSDK\1.3.211.0\Bin\glslc.exe" Shaders\depth_pyramid.comp -o Shaders\depth_pyramid.comp.spv
 pause
\ No newline at end of file
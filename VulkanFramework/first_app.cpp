@@ -2,15 +2,65 @@
 
 #include "KeyboardMovementController.h"
 #include "first_app.h"
+#include "UploadService.h"
 #include <stdexcept>
+#include <algorithm>
 #include <array>
 #include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
 
 static float constexpr MAX_FRAME_TIME = 0.167f;
+// fewer draws than this per thread are recorded inline rather than split across secondary command buffers
+static uint32_t constexpr MIN_DRAWS_PER_SLICE = 64;
 
-FirstApp::FirstApp()
+FirstApp::Options FirstApp::Options::parse(int argc, char* argv[])
 {
-	loadGameObjects();
+	Options options{};
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string argument = argv[i];
+		if (argument == "--gpu-culling")
+		{
+			options.gpuCulling = true;
+		}
+		else if (argument == "--occlusion-culling")
+		{
+			options.gpuCulling = true;
+			options.occlusionCulling = true;
+		}
+		else if (argument == "--no-draw-count")
+		{
+			options.noIndirectCount = true;
+		}
+		else if (argument == "--frames" && i + 1 < argc)
+		{
+			options.frameCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (argument == "--entities" && i + 1 < argc)
+		{
+			options.stressEntityCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (argument == "--threads" && i + 1 < argc)
+		{
+			options.threadCount = std::max(1u, static_cast<unsigned int>(std::stoul(argv[++i])));
+		}
+		else
+		{
+			throw std::runtime_error("Unknown argument " + argument + "!");
+		}
+	}
+	return options;
+}
+
+FirstApp::FirstApp(const Options& options)
+	:
+	options(options)
+{
+	loadEntities();
+	device.uploadService().flush();
+	device.allocator().printStats(std::cout);
 }
 
 FirstApp::~FirstApp()
@@ -19,15 +69,24 @@ FirstApp::~FirstApp()
 void FirstApp::run()
 {
 	SimpleRenderSystem simpleRenderSystem{device, renderer.getSwapChainRenderPass()};
+	const bool gpuCulling = options.gpuCulling && simpleRenderSystem.supportsGpuCulling();
+	simpleRenderSystem.setOcclusionCulling(gpuCulling && options.occlusionCulling);
+	simpleRenderSystem.setIndirectCount(!options.noIndirectCount);
+	const bool occlusionCulling = simpleRenderSystem.isOcclusionCulling();
     Camera camera{};
     camera.setViewTarget(glm::vec3(-3.0f, -4.0f, 5.0f), glm::vec3(0.0f, 0.0f, 2.5f));
 
-    auto viewerObject = GameObject::createGameObject();;
+    TransformComponent viewerTransform{};
     KeyboardMovementController cameraController{};
 
     auto currentTime = std::chrono::high_resolution_clock::now();
+	// CPU path: culling, sorting and uploads, then recording the draws
+	double prepareSeconds = 0.0;
+	double recordSeconds = 0.0;
+	uint64_t recordedDraws = 0;
+	uint32_t recordedFrames = 0;
 
-	while (!window.shouldClose())
+	for (uint32_t frame = 0; !window.shouldClose() && (options.frameCount == 0 || frame < options.frameCount); frame++)
 	{
 		glfwPollEvents();
 
@@ -37,39 +96,116 @@ void FirstApp::run()
 
         frameTime = glm::min(frameTime, MAX_FRAME_TIME);
 
-        cameraController.moveInPlaneXZ(window.getGLFWwindow(), frameTime, viewerObject);
-        camera.setViewYXZ(viewerObject.transform.translation, viewerObject.transform.rotation);
+        cameraController.moveInPlaneXZ(window.getGLFWwindow(), frameTime, viewerTransform);
+        camera.setViewYXZ(viewerTransform.getTranslation(), viewerTransform.getRotation());
 
         float aspect = renderer.getAspectRatio();
         camera.setPerspectiveProjection(glm::pi<float>() / 4.0f, aspect, 0.1f, 100.0f);
 		
+		entities.updateTransforms(&threadPool);
 		if (auto commandBuffer = renderer.beginFrame())
 		{
-			renderer.beginSwapChainRenderPass(commandBuffer);
-			simpleRenderSystem.renderGameObjects(commandBuffer, gameObjects, camera);
+			const VkExtent2D viewportExtent = renderer.getSwapChainExtent();
+			if (occlusionCulling)
+			{
+				// draw what was visible last frame, test everything else against its depth and draw the rest
+				simpleRenderSystem.cullEntitiesOnGpu(commandBuffer, renderer.getFrameIndex(), entities, camera, viewportExtent);
+				renderer.beginSwapChainRenderPass(commandBuffer, SwapChainPass::KeepDepth);
+				simpleRenderSystem.renderCulledEntities(commandBuffer, renderer.getFrameIndex(), 0);
+				renderer.endSwapChainRenderPass(commandBuffer);
+				simpleRenderSystem.cullOccludedEntitiesOnGpu(commandBuffer, renderer.getFrameIndex(), renderer.getDepthImageView());
+				renderer.beginSwapChainRenderPass(commandBuffer, SwapChainPass::Resume);
+				simpleRenderSystem.renderCulledEntities(commandBuffer, renderer.getFrameIndex(), 1);
+			}
+			else if (gpuCulling)
+			{
+				// the cull dispatch has to be recorded outside the render pass
+				simpleRenderSystem.cullEntitiesOnGpu(commandBuffer, renderer.getFrameIndex(), entities, camera, viewportExtent);
+				renderer.beginSwapChainRenderPass(commandBuffer);
+				simpleRenderSystem.renderCulledEntities(commandBuffer, renderer.getFrameIndex());
+			}
+			else
+			{
+				const int frameIndex = renderer.getFrameIndex();
+				const auto prepareStart = std::chrono::high_resolution_clock::now();
+				const uint32_t drawCount = simpleRenderSystem.prepareEntities(frameIndex, entities, camera,
+					static_cast<float>(viewportExtent.height));
+				const auto recordStart = std::chrono::high_resolution_clock::now();
+				const uint32_t sliceCount = std::min(drawCount / MIN_DRAWS_PER_SLICE, threadPool.getThreadCount());
+				if (sliceCount > 1)
+				{
+					renderer.beginSwapChainRenderPass(commandBuffer, SwapChainPass::Whole, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+					renderer.recordSecondaryCommandBuffers(commandBuffer, threadPool, sliceCount, [&](VkCommandBuffer secondary, uint32_t slice)
+					{
+						const uint32_t firstDraw = drawCount * slice / sliceCount;
+						simpleRenderSystem.recordDraws(secondary, frameIndex, entities, firstDraw, drawCount * (slice + 1) / sliceCount - firstDraw);
+					});
+				}
+				else
+				{
+					renderer.beginSwapChainRenderPass(commandBuffer);
+					simpleRenderSystem.recordDraws(commandBuffer, frameIndex, entities, 0, drawCount);
+				}
+				const auto recordEnd = std::chrono::high_resolution_clock::now();
+				prepareSeconds += std::chrono::duration<double>(recordStart - prepareStart).count();
+				recordSeconds += std::chrono::duration<double>(recordEnd - recordStart).count();
+				recordedDraws += drawCount;
+				recordedFrames++;
+			}
 			renderer.endSwapChainRenderPass(commandBuffer);
 			renderer.endFrame();
 		}
 	}
 
 	vkDeviceWaitIdle(device.device());
+
+	if (recordedFrames > 0)
+	{
+		std::cout << recordedFrames << " frames on " << threadPool.getThreadCount() << " threads, "
+			<< recordedDraws / recordedFrames << " draws per frame: prepare " << prepareSeconds * 1000.0 / recordedFrames
+			<< " ms, record " << recordSeconds * 1000.0 / recordedFrames << " ms per frame" << std::endl;
+	}
 }
 
-void FirstApp::loadGameObjects()
+void FirstApp::loadEntities()
 {
-    std::shared_ptr<Model> model = Model::createModelFromFile(device, "models/smooth_vase.obj");
-
-    auto gameObj = GameObject::createGameObject();
-    gameObj.model = model;
-    gameObj.transform.translation = { 0.5f, 0.5f, 2.5f };
-    gameObj.transform.scale= glm::vec3{ 3.0f };
-    gameObjects.push_back(std::move(gameObj));
-
-    model = Model::createModelFromFile(device, "models/flat_vase.obj");
-
-    auto gameObj1 = GameObject::createGameObject();
-    gameObj1.model = model;
-    gameObj1.transform.translation = { -0.5f, 0.5f, 2.5f };
-    gameObj1.transform.scale = glm::vec3{ 3.0f, 1.5f, 3.0f };
-    gameObjects.push_back(std::move(gameObj1));
+    Model::LoadOptions loadOptions{};
+    loadOptions.threadPool = &threadPool;
+    loadOptions.optimize = true;
+    loadOptions.generateLods = true;
+    loadOptions.buildMeshlets = true;
+    loadOptions.report = &std::cout;
+
+    Model::LoadOptions packedLoadOptions = loadOptions;
+    packedLoadOptions.vertexFormat = VertexFormat::Packed;
+
+    std::shared_ptr<Model> smoothVaseModel = Model::createModelFromFile(packedGeometryPool, "models/smooth_vase.obj", packedLoadOptions);
+    EntityStore::ModelHandle model = entities.addModel(smoothVaseModel);
+
+    Entity smoothVase = entities.create();
+    entities.model(smoothVase) = model;
+    entities.transform(smoothVase).setTranslation({ 0.5f, 0.5f, 2.5f });
+    entities.transform(smoothVase).setScale(glm::vec3{ 3.0f });
+
+    std::shared_ptr<Model> flatVaseModel = Model::createModelFromFile(geometryPool, "models/flat_vase.obj", loadOptions);
+    model = entities.addModel(flatVaseModel);
+
+    Entity flatVase = entities.create();
+    entities.model(flatVase) = model;
+    entities.transform(flatVase).setTranslation({ -0.5f, 0.5f, 2.5f });
+    entities.transform(flatVase).setScale(glm::vec3{ 3.0f, 1.5f, 3.0f });
+
+    // a square wall ahead of the camera that stays in view; handles of the same model don't share draws
+    const uint32_t columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(options.stressEntityCount))));
+    const float spacing = 0.05f;
+    entities.reserve(entities.size() + options.stressEntityCount);
+    for (uint32_t i = 0; i < options.stressEntityCount; i++)
+    {
+        Entity vase = entities.create();
+        entities.model(vase) = entities.addModel(i % 2 == 0 ? smoothVaseModel : flatVaseModel);
+        const float x = (static_cast<float>(i % columns) - 0.5f * static_cast<float>(columns - 1)) * spacing;
+        const float y = (static_cast<float>(i / columns) - 0.5f * static_cast<float>(columns - 1)) * spacing;
+        entities.transform(vase).setTranslation({ x, y, 15.0f });
+        entities.transform(vase).setScale(glm::vec3{ 0.1f });
+    }
 }
@@ -15,16 +15,42 @@ public:
 	static constexpr int width = 800;
 	static constexpr int height = 600;
 
-	FirstApp();
+	struct Options
+	{
+		// Cull and pick LODs in a compute pass and draw indirectly, where the device supports it.
+		// Off by default: LOD hysteresis, meshlet culling, draw stats and parallel recording are CPU path only.
+		bool gpuCulling = false;
+		// two phase occlusion culling, implies gpuCulling
+		bool occlusionCulling = false;
+		// draw the GPU path's batches without vkCmdDrawIndexedIndirectCount even where it is supported
+		bool noIndirectCount = false;
+		// exit after this many frames, 0 runs until the window closes
+		uint32_t frameCount = 0;
+		// Extra vases in a wall facing the camera, each with its own model handle so each is a draw of its own.
+		// Stresses draw recording; the CPU path prints its recording times on exit.
+		uint32_t stressEntityCount = 0;
+		// for loading, transforms and recording, including the calling thread
+		unsigned int threadCount = std::thread::hardware_concurrency();
+
+		// --gpu-culling, --occlusion-culling, --no-draw-count, --frames <count>, --entities <count>, --threads <count>
+		static Options parse(int argc, char* argv[]);
+	};
+
+	explicit FirstApp(const Options& options);
 	~FirstApp();
 	FirstApp(const FirstApp&) = delete;
 	FirstApp& operator=(const FirstApp&) = delete;
 	void run();
 private:
-	void loadGameObjects();
+	void loadEntities();
 private:
+	Options options;
 	Window window{width, height, "Vulkan Framework"};
 	EngineDevice device{window};
 	Renderer renderer{window, device};
-	std::vector<GameObject> gameObjects;
+	ThreadPool threadPool{ options.threadCount };
+	GeometryPool geometryPool{device, sizeof(Model::Vertex)};
+	GeometryPool packedGeometryPool{device, sizeof(Model::PackedVertex)};
+	// SimpleRenderSystem sorts draws by keys with room for this many models
+	EntityStore entities{ DrawList::MAX_MODELS };
 };
\ No newline at end of file